@@ -53,6 +53,7 @@ public:
     /* The frame_number advances with every call to Helper::SDL_RenderPresent() */
     static inline int frame_number = 0;
     static inline Uint32 current_frame_start_timestamp = 0;
+    static inline Uint32 desired_frame_duration_milliseconds = 16;
     static int GetFrameNumber() { return frame_number; }
 
     static SDL_Window* SDL_CreateWindow498(const char* title, int x, int y, int w, int h, Uint32 flags)
@@ -343,7 +344,6 @@ private:
         {
             Uint32 current_frame_end_timestamp = SDL_GetTicks();  // Record end time of the frame
             Uint32 current_frame_duration_milliseconds = current_frame_end_timestamp - current_frame_start_timestamp;
-            Uint32 desired_frame_duration_milliseconds = 16;
 
             int delay_ticks = std::max(static_cast<int>(desired_frame_duration_milliseconds) - static_cast<int>(current_frame_duration_milliseconds), 1);
 
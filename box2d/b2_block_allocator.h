@@ -48,6 +48,10 @@ public:
 
 	void Clear();
 
+	/// Return every block to the free lists without releasing any chunks. All
+	/// outstanding allocations become invalid. Cost is linear in the number of chunks.
+	void Reset();
+
 private:
 
 	b2Chunk* m_chunks;
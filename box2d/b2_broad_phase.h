@@ -108,9 +108,13 @@ public:
 	/// @param newOrigin the new origin with respect to the old origin
 	void ShiftOrigin(const b2Vec2& newOrigin);
 
+	/// Remove every proxy and pending pair. Buffers keep their capacity.
+	void Reset();
+
 private:
 
 	friend class b2DynamicTree;
+	friend class b2World;
 
 	void BufferMove(int32 proxyId);
 	void UnBufferMove(int32 proxyId);
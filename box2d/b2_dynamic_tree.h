@@ -133,8 +133,13 @@ public:
 	/// @param newOrigin the new origin with respect to the old origin
 	void ShiftOrigin(const b2Vec2& newOrigin);
 
+	/// Remove every proxy at once. The node pool keeps its capacity.
+	void Reset();
+
 private:
 
+	friend class b2World;
+
 	int32 AllocateNode();
 	void FreeNode(int32 node);
 
@@ -142,6 +142,27 @@ struct B2_API b2Vec2
     {
         return b2Vec2(x * multiplier, y * multiplier);
     }
+    
+    /// In-place versions for lua, these don't allocate a new userdata
+    void AddInPlace(const b2Vec2& other)
+    {
+        x += other.x; y += other.y;
+    }
+    
+    void SubInPlace(const b2Vec2& other)
+    {
+        x -= other.x; y -= other.y;
+    }
+    
+    void MulInPlace(const float multiplier)
+    {
+        x *= multiplier; y *= multiplier;
+    }
+    
+    void CopyFrom(const b2Vec2& other)
+    {
+        x = other.x; y = other.y;
+    }
 };
 
 /// A 2D column vector with 3 elements.
@@ -26,7 +26,9 @@
 #include "b2_api.h"
 #include "b2_settings.h"
 
-const int32 b2_stackSize = 100 * 1024;	// 100k
+const int32 b2_stackSize = 100 * 1024;	// 100k initial capacity
+const int32 b2_stackChunkSize = 64 * 1024;	// growth granularity
+const int32 b2_stackAlignment = 16;
 const int32 b2_maxStackEntries = 32;
 
 struct B2_API b2StackEntry
@@ -39,6 +41,9 @@ struct B2_API b2StackEntry
 // This is a stack allocator used for fast per step allocations.
 // You must nest allocate/free pairs. The code will assert
 // if you try to interleave multiple allocate/free pairs.
+// Allocations that overflow the buffer fall back to b2Alloc; once the stack
+// is empty again the buffer grows in chunks to cover the high-water mark,
+// so later steps of the same size stay out of malloc.
 class B2_API b2StackAllocator
 {
 public:
@@ -48,15 +53,33 @@ public:
 	void* Allocate(int32 size);
 	void Free(void* p);
 
+	/// Grow the buffer to hold at least size bytes. Only allowed while the stack is empty.
+	void Reserve(int32 size);
+
+	/// Get the largest number of bytes live at once.
 	int32 GetMaxAllocation() const;
 
+	/// Get the size of the buffer in bytes.
+	int32 GetCapacity() const;
+
+	/// Get the number of allocations that did not fit and used b2Alloc.
+	int32 GetOverflowCount() const;
+
+	/// Restart peak and overflow tracking. The buffer keeps its size.
+	void ResetStats();
+
+	/// Get the stack allocator owned by the calling thread.
+	static b2StackAllocator& GetThreadAllocator();
+
 private:
 
-	char m_data[b2_stackSize];
+	char* m_data;
+	int32 m_capacity;
 	int32 m_index;
 
 	int32 m_allocation;
 	int32 m_maxAllocation;
+	int32 m_overflowCount;
 
 	b2StackEntry m_entries[b2_maxStackEntries];
 	int32 m_entryCount;
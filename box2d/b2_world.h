@@ -204,6 +204,28 @@ public:
 	/// @param newOrigin the new origin with respect to the old origin
 	void ShiftOrigin(const b2Vec2& newOrigin);
 
+	/// Destroy all bodies, fixtures, joints, contacts and broad-phase proxies in bulk.
+	/// Memory is returned to the block allocator instead of the system, so the next
+	/// scene reuses the same chunks. No destruction or contact callbacks are issued.
+	/// All body, fixture and joint pointers become invalid.
+	/// @warning This function is locked during callbacks.
+	void Reset();
+
+	/// Write the dynamic state of the world into a compact binary snapshot: bodies,
+	/// fixture proxies, the broad-phase tree and move buffer, and every contact with
+	/// its manifold and warm-starting impulses. Joint state is not included.
+	/// @param buffer destination, or nullptr to only measure the snapshot.
+	/// @return the size of the snapshot in bytes.
+	int32 SaveSnapshot(void* buffer) const;
+
+	/// Restore a snapshot taken from this world. Bodies and fixtures are restored in
+	/// place, so the world must hold the same bodies and fixtures, in the same order,
+	/// as when the snapshot was taken. Contacts are rebuilt from the block allocator
+	/// without contact callbacks. Stepping afterwards reproduces the original run exactly.
+	/// @return false if the snapshot does not match this world or is malformed, or if
+	/// called during a callback while the world is locked. The world is then unchanged.
+	bool RestoreSnapshot(const void* buffer, int32 size);
+
 	/// Get the contact manager for testing.
 	const b2ContactManager& GetContactManager() const;
 
@@ -227,7 +249,6 @@ private:
 	void DrawShape(b2Fixture* shape, const b2Transform& xf, const b2Color& color);
 
 	b2BlockAllocator m_blockAllocator;
-	b2StackAllocator m_stackAllocator;
 
 	b2ContactManager m_contactManager;
 
@@ -42,6 +42,14 @@ b2BroadPhase::~b2BroadPhase()
 	b2Free(m_pairBuffer);
 }
 
+void b2BroadPhase::Reset()
+{
+	m_tree.Reset();
+	m_proxyCount = 0;
+	m_moveCount = 0;
+	m_pairCount = 0;
+}
+
 int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
 {
 	int32 proxyId = m_tree.CreateProxy(aabb, userData);
@@ -228,3 +228,28 @@ void b2BlockAllocator::Clear()
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 	memset(m_freeLists, 0, sizeof(m_freeLists));
 }
+
+void b2BlockAllocator::Reset()
+{
+	memset(m_freeLists, 0, sizeof(m_freeLists));
+
+	for (int32 i = 0; i < m_chunkCount; ++i)
+	{
+		b2Chunk* chunk = m_chunks + i;
+		int32 blockSize = chunk->blockSize;
+		int32 index = b2_sizeMap.values[blockSize];
+		int32 blockCount = b2_chunkSize / blockSize;
+
+		// Re-thread the chunk and push it onto the front of its free list.
+		for (int32 j = 0; j < blockCount - 1; ++j)
+		{
+			b2Block* block = (b2Block*)((int8*)chunk->blocks + blockSize * j);
+			b2Block* next = (b2Block*)((int8*)chunk->blocks + blockSize * (j + 1));
+			block->next = next;
+		}
+		b2Block* last = (b2Block*)((int8*)chunk->blocks + blockSize * (blockCount - 1));
+		last->next = m_freeLists[index];
+
+		m_freeLists[index] = chunk->blocks;
+	}
+}
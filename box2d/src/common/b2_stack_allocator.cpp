@@ -25,9 +25,12 @@
 
 b2StackAllocator::b2StackAllocator()
 {
+	m_capacity = b2_stackSize;
+	m_data = (char*)b2Alloc(m_capacity);
 	m_index = 0;
 	m_allocation = 0;
 	m_maxAllocation = 0;
+	m_overflowCount = 0;
 	m_entryCount = 0;
 }
 
@@ -35,18 +38,23 @@ b2StackAllocator::~b2StackAllocator()
 {
 	b2Assert(m_index == 0);
 	b2Assert(m_entryCount == 0);
+	b2Free(m_data);
 }
 
 void* b2StackAllocator::Allocate(int32 size)
 {
 	b2Assert(m_entryCount < b2_maxStackEntries);
 
+	// Keep every entry aligned for SIMD-friendly solver data.
+	size = (size + b2_stackAlignment - 1) & ~(b2_stackAlignment - 1);
+
 	b2StackEntry* entry = m_entries + m_entryCount;
 	entry->size = size;
-	if (m_index + size > b2_stackSize)
+	if (m_index + size > m_capacity)
 	{
 		entry->data = (char*)b2Alloc(size);
 		entry->usedMalloc = true;
+		++m_overflowCount;
 	}
 	else
 	{
@@ -78,10 +86,51 @@ void b2StackAllocator::Free(void* p)
 	m_allocation -= entry->size;
 	--m_entryCount;
 
+	// Grow to the high-water mark between steps.
+	if (m_entryCount == 0 && m_maxAllocation > m_capacity)
+	{
+		Reserve(m_maxAllocation);
+	}
+
 	p = nullptr;
 }
 
+void b2StackAllocator::Reserve(int32 size)
+{
+	b2Assert(m_entryCount == 0);
+	if (m_entryCount != 0 || size <= m_capacity)
+	{
+		return;
+	}
+
+	b2Free(m_data);
+	m_capacity = ((size + b2_stackChunkSize - 1) / b2_stackChunkSize) * b2_stackChunkSize;
+	m_data = (char*)b2Alloc(m_capacity);
+}
+
 int32 b2StackAllocator::GetMaxAllocation() const
 {
 	return m_maxAllocation;
 }
+
+int32 b2StackAllocator::GetCapacity() const
+{
+	return m_capacity;
+}
+
+int32 b2StackAllocator::GetOverflowCount() const
+{
+	return m_overflowCount;
+}
+
+void b2StackAllocator::ResetStats()
+{
+	m_maxAllocation = m_allocation;
+	m_overflowCount = 0;
+}
+
+b2StackAllocator& b2StackAllocator::GetThreadAllocator()
+{
+	static thread_local b2StackAllocator s_allocator;
+	return s_allocator;
+}
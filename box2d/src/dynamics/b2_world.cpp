@@ -397,11 +397,14 @@ void b2World::Solve(const b2TimeStep& step)
 	m_profile.solveVelocity = 0.0f;
 	m_profile.solvePosition = 0.0f;
 
+	// Per step scratch memory comes from the solving thread's stack.
+	b2StackAllocator* stackAllocator = &b2StackAllocator::GetThreadAllocator();
+
 	// Size the island for the worst case.
 	b2Island island(m_bodyCount,
 					m_contactManager.m_contactCount,
 					m_jointCount,
-					&m_stackAllocator,
+					stackAllocator,
 					m_contactManager.m_contactListener);
 
 	// Clear all the island flags.
@@ -420,7 +423,7 @@ void b2World::Solve(const b2TimeStep& step)
 
 	// Build and simulate all awake islands.
 	int32 stackSize = m_bodyCount;
-	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
+	b2Body** stack = (b2Body**)stackAllocator->Allocate(stackSize * sizeof(b2Body*));
 	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
 	{
 		if (seed->m_flags & b2Body::e_islandFlag)
@@ -553,7 +556,7 @@ void b2World::Solve(const b2TimeStep& step)
 		}
 	}
 
-	m_stackAllocator.Free(stack);
+	stackAllocator->Free(stack);
 
 	{
 		b2Timer timer;
@@ -584,7 +587,7 @@ void b2World::Solve(const b2TimeStep& step)
 // Find TOI contacts and solve them.
 void b2World::SolveTOI(const b2TimeStep& step)
 {
-	b2Island island(2 * b2_maxTOIContacts, b2_maxTOIContacts, 0, &m_stackAllocator, m_contactManager.m_contactListener);
+	b2Island island(2 * b2_maxTOIContacts, b2_maxTOIContacts, 0, &b2StackAllocator::GetThreadAllocator(), m_contactManager.m_contactListener);
 
 	if (m_stepComplete)
 	{
@@ -1257,6 +1260,535 @@ void b2World::ShiftOrigin(const b2Vec2& newOrigin)
 	m_contactManager.m_broadPhase.ShiftOrigin(newOrigin);
 }
 
+void b2World::Reset()
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	// Chain shapes own vertex storage from b2Alloc and may need oversized proxy arrays.
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b2Fixture* f = b->m_fixtureList;
+		while (f)
+		{
+			b2Fixture* fNext = f->m_next;
+			if (f->m_shape->m_type == b2Shape::e_chain)
+			{
+				f->m_proxyCount = 0;
+				f->Destroy(&m_blockAllocator);
+			}
+			f = fNext;
+		}
+	}
+
+	m_contactManager.m_broadPhase.Reset();
+	m_contactManager.m_contactList = nullptr;
+	m_contactManager.m_contactCount = 0;
+
+	m_bodyList = nullptr;
+	m_jointList = nullptr;
+	m_bodyCount = 0;
+	m_jointCount = 0;
+
+	m_blockAllocator.Reset();
+
+	m_newContacts = false;
+	m_stepComplete = true;
+	m_inv_dt0 = 0.0f;
+}
+
+static const uint32 b2_snapshotMagic = 0x4e533262; // "b2SN"
+
+// Sequential writer used by SaveSnapshot. With a null buffer it only counts bytes.
+struct b2SnapshotWriter
+{
+	template <typename T>
+	void Write(const T& value)
+	{
+		if (data)
+		{
+			memcpy(data + offset, &value, sizeof(T));
+		}
+		offset += int32(sizeof(T));
+	}
+
+	uint8* data;
+	int32 offset;
+};
+
+// Bounds-checked reader used by RestoreSnapshot.
+struct b2SnapshotReader
+{
+	template <typename T>
+	T Read()
+	{
+		// Math types have empty constructors, so a short read copies zeros in instead.
+		static const uint8 zeros[sizeof(T)] = {};
+		T value;
+		if (offset + int32(sizeof(T)) > size)
+		{
+			valid = false;
+			memcpy(&value, zeros, sizeof(T));
+			return value;
+		}
+		memcpy(&value, data + offset, sizeof(T));
+		offset += int32(sizeof(T));
+		return value;
+	}
+
+	const uint8* data;
+	int32 size;
+	int32 offset;
+	bool valid;
+};
+
+// Everything needed to rebuild a contact; proxy ids identify the fixture children.
+struct b2ContactSnapshot
+{
+	int32 proxyIdA;
+	int32 proxyIdB;
+	uint32 flags;
+	b2Manifold manifold;
+	int32 toiCount;
+	float toi;
+	float friction;
+	float restitution;
+	float restitutionThreshold;
+	float tangentSpeed;
+};
+
+int32 b2World::SaveSnapshot(void* buffer) const
+{
+	b2SnapshotWriter writer;
+	writer.data = (uint8*)buffer;
+	writer.offset = 0;
+
+	const b2ContactManager& cm = m_contactManager;
+	const b2BroadPhase& bp = cm.m_broadPhase;
+	const b2DynamicTree& tree = bp.m_tree;
+
+	writer.Write(b2_snapshotMagic);
+	writer.Write(m_bodyCount);
+	writer.Write(m_jointCount);
+	writer.Write(cm.m_contactCount);
+
+	writer.Write(m_gravity);
+	writer.Write(m_inv_dt0);
+	writer.Write(m_allowSleep);
+	writer.Write(m_newContacts);
+	writer.Write(m_clearForces);
+	writer.Write(m_stepComplete);
+
+	for (const b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		writer.Write(int32(b->m_type));
+		writer.Write(b->m_fixtureCount);
+		writer.Write(b->m_flags);
+		writer.Write(b->m_xf);
+		writer.Write(b->m_sweep);
+		writer.Write(b->m_linearVelocity);
+		writer.Write(b->m_angularVelocity);
+		writer.Write(b->m_force);
+		writer.Write(b->m_torque);
+		writer.Write(b->m_mass);
+		writer.Write(b->m_invMass);
+		writer.Write(b->m_I);
+		writer.Write(b->m_invI);
+		writer.Write(b->m_linearDamping);
+		writer.Write(b->m_angularDamping);
+		writer.Write(b->m_gravityScale);
+		writer.Write(b->m_sleepTime);
+
+		for (const b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			writer.Write(f->m_proxyCount);
+			for (int32 i = 0; i < f->m_proxyCount; ++i)
+			{
+				writer.Write(f->m_proxies[i].aabb);
+				writer.Write(f->m_proxies[i].proxyId);
+			}
+		}
+	}
+
+	// The tree is stored node for node so proxy ids and pair order come back unchanged.
+	writer.Write(tree.m_nodeCapacity);
+	writer.Write(tree.m_root);
+	writer.Write(tree.m_freeList);
+	writer.Write(tree.m_nodeCount);
+	writer.Write(tree.m_insertionCount);
+	for (int32 i = 0; i < tree.m_nodeCapacity; ++i)
+	{
+		const b2TreeNode& node = tree.m_nodes[i];
+		writer.Write(node.aabb);
+		writer.Write(node.parent);
+		writer.Write(node.child1);
+		writer.Write(node.child2);
+		writer.Write(node.height);
+		writer.Write(node.moved);
+	}
+
+	writer.Write(bp.m_proxyCount);
+	writer.Write(bp.m_moveCount);
+	for (int32 i = 0; i < bp.m_moveCount; ++i)
+	{
+		writer.Write(bp.m_moveBuffer[i]);
+	}
+
+	for (const b2Contact* c = cm.m_contactList; c; c = c->m_next)
+	{
+		b2ContactSnapshot cs{};
+		cs.proxyIdA = c->m_fixtureA->m_proxies[c->m_indexA].proxyId;
+		cs.proxyIdB = c->m_fixtureB->m_proxies[c->m_indexB].proxyId;
+		cs.flags = c->m_flags;
+		cs.manifold = c->m_manifold;
+		cs.toiCount = c->m_toiCount;
+		cs.toi = c->m_toi;
+		cs.friction = c->m_friction;
+		cs.restitution = c->m_restitution;
+		cs.restitutionThreshold = c->m_restitutionThreshold;
+		cs.tangentSpeed = c->m_tangentSpeed;
+		writer.Write(cs);
+	}
+
+	return writer.offset;
+}
+
+bool b2World::RestoreSnapshot(const void* buffer, int32 size)
+{
+	// Callers restoring from a contact callback must wait until the step finishes.
+	if (IsLocked() || buffer == nullptr)
+	{
+		return false;
+	}
+
+	b2SnapshotReader reader;
+	reader.data = (const uint8*)buffer;
+	reader.size = size;
+	reader.offset = 0;
+	reader.valid = true;
+
+	if (reader.Read<uint32>() != b2_snapshotMagic ||
+		reader.Read<int32>() != m_bodyCount ||
+		reader.Read<int32>() != m_jointCount)
+	{
+		return false;
+	}
+	int32 contactCount = reader.Read<int32>();
+
+	b2Vec2 gravity = reader.Read<b2Vec2>();
+	float inv_dt0 = reader.Read<float>();
+	bool allowSleep = reader.Read<bool>();
+	bool newContacts = reader.Read<bool>();
+	bool clearForces = reader.Read<bool>();
+	bool stepComplete = reader.Read<bool>();
+
+	// Validate the whole snapshot before touching anything: the body and fixture layout,
+	// then the tree, move buffer and contacts against it.
+	const int32 bodySize = int32(sizeof(uint16) + sizeof(b2Transform) + sizeof(b2Sweep) + 2 * sizeof(b2Vec2) + 10 * sizeof(float));
+	const int32 nodeSize = int32(sizeof(b2AABB) + 4 * sizeof(int32) + sizeof(bool));
+	int32 bodyOffset = reader.offset;
+	for (b2Body* b = m_bodyList; b && reader.valid; b = b->m_next)
+	{
+		if (reader.Read<int32>() != int32(b->m_type) || reader.Read<int32>() != b->m_fixtureCount)
+		{
+			return false;
+		}
+		reader.offset += bodySize;
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			// Disabled bodies have no proxies.
+			int32 proxyCount = reader.Read<int32>();
+			if (proxyCount != 0 && proxyCount != f->GetShape()->GetChildCount())
+			{
+				return false;
+			}
+			reader.offset += proxyCount * int32(sizeof(b2AABB) + sizeof(int32));
+		}
+	}
+	if (reader.valid == false || reader.offset > size)
+	{
+		return false;
+	}
+
+	int32 nodeCapacity = reader.Read<int32>();
+	int32 root = reader.Read<int32>();
+	int32 freeList = reader.Read<int32>();
+	reader.Read<int32>();
+	reader.Read<int32>();
+	if (reader.valid == false || nodeCapacity < 0 || nodeCapacity > (size - reader.offset) / nodeSize ||
+		root < b2_nullNode || root >= nodeCapacity || freeList < b2_nullNode || freeList >= nodeCapacity)
+	{
+		return false;
+	}
+	for (int32 i = 0; i < nodeCapacity; ++i)
+	{
+		reader.Read<b2AABB>();
+		int32 parent = reader.Read<int32>();
+		int32 child1 = reader.Read<int32>();
+		int32 child2 = reader.Read<int32>();
+		reader.Read<int32>();
+		reader.Read<bool>();
+		if (parent < b2_nullNode || parent >= nodeCapacity ||
+			child1 < b2_nullNode || child1 >= nodeCapacity ||
+			child2 < b2_nullNode || child2 >= nodeCapacity)
+		{
+			return false;
+		}
+	}
+
+	reader.Read<int32>();
+	int32 moveCount = reader.Read<int32>();
+	if (reader.valid == false || moveCount < 0 || moveCount > (size - reader.offset) / int32(sizeof(int32)))
+	{
+		return false;
+	}
+	for (int32 i = 0; i < moveCount; ++i)
+	{
+		int32 proxyId = reader.Read<int32>();
+		if (proxyId < b2_nullNode || proxyId >= nodeCapacity)
+		{
+			return false;
+		}
+	}
+	if (contactCount < 0 || contactCount > (size - reader.offset) / int32(sizeof(b2ContactSnapshot)))
+	{
+		return false;
+	}
+	int32 contactOffset = reader.offset;
+
+	// Each fixture proxy must own a distinct node, and contacts may only name those leaves.
+	uint8* leaves = (uint8*)b2Alloc(b2Max(nodeCapacity, 1));
+	memset(leaves, 0, b2Max(nodeCapacity, 1));
+	bool valid = true;
+	reader.offset = bodyOffset;
+	for (b2Body* b = m_bodyList; b && valid; b = b->m_next)
+	{
+		reader.offset += 2 * int32(sizeof(int32)) + bodySize;
+		for (b2Fixture* f = b->m_fixtureList; f && valid; f = f->m_next)
+		{
+			int32 proxyCount = reader.Read<int32>();
+			for (int32 i = 0; i < proxyCount && valid; ++i)
+			{
+				reader.Read<b2AABB>();
+				int32 proxyId = reader.Read<int32>();
+				valid = proxyId >= 0 && proxyId < nodeCapacity && leaves[proxyId] == 0;
+				if (valid)
+				{
+					leaves[proxyId] = 1;
+				}
+			}
+		}
+	}
+	reader.offset = contactOffset;
+	for (int32 i = 0; i < contactCount && valid; ++i)
+	{
+		b2ContactSnapshot cs = reader.Read<b2ContactSnapshot>();
+		valid = cs.proxyIdA >= 0 && cs.proxyIdA < nodeCapacity && leaves[cs.proxyIdA] != 0 &&
+			cs.proxyIdB >= 0 && cs.proxyIdB < nodeCapacity && leaves[cs.proxyIdB] != 0;
+	}
+	b2Free(leaves);
+	if (valid == false || reader.valid == false)
+	{
+		return false;
+	}
+
+	// Drop current contacts straight into the block allocator. Bodies are overwritten below,
+	// so the wake-up done by b2Contact::Destroy does not leak into the restored state.
+	b2Contact* c = m_contactManager.m_contactList;
+	while (c)
+	{
+		b2Contact* cNext = c->m_next;
+		b2Contact::Destroy(c, &m_blockAllocator);
+		c = cNext;
+	}
+	m_contactManager.m_contactList = nullptr;
+	m_contactManager.m_contactCount = 0;
+
+	reader.offset = bodyOffset;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		reader.Read<int32>();
+		reader.Read<int32>();
+		b->m_flags = reader.Read<uint16>();
+		b->m_xf = reader.Read<b2Transform>();
+		b->m_sweep = reader.Read<b2Sweep>();
+		b->m_linearVelocity = reader.Read<b2Vec2>();
+		b->m_angularVelocity = reader.Read<float>();
+		b->m_force = reader.Read<b2Vec2>();
+		b->m_torque = reader.Read<float>();
+		b->m_mass = reader.Read<float>();
+		b->m_invMass = reader.Read<float>();
+		b->m_I = reader.Read<float>();
+		b->m_invI = reader.Read<float>();
+		b->m_linearDamping = reader.Read<float>();
+		b->m_angularDamping = reader.Read<float>();
+		b->m_gravityScale = reader.Read<float>();
+		b->m_sleepTime = reader.Read<float>();
+		b->m_contactList = nullptr;
+
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			f->m_proxyCount = reader.Read<int32>();
+			for (int32 i = 0; i < f->m_proxyCount; ++i)
+			{
+				f->m_proxies[i].aabb = reader.Read<b2AABB>();
+				f->m_proxies[i].proxyId = reader.Read<int32>();
+				f->m_proxies[i].fixture = f;
+				f->m_proxies[i].childIndex = i;
+			}
+		}
+	}
+
+	b2BroadPhase& bp = m_contactManager.m_broadPhase;
+	b2DynamicTree& tree = bp.m_tree;
+
+	reader.Read<int32>();
+	if (tree.m_nodeCapacity < nodeCapacity)
+	{
+		b2Free(tree.m_nodes);
+		tree.m_nodeCapacity = nodeCapacity;
+		tree.m_nodes = (b2TreeNode*)b2Alloc(nodeCapacity * sizeof(b2TreeNode));
+	}
+	tree.m_root = reader.Read<int32>();
+	tree.m_freeList = reader.Read<int32>();
+	tree.m_nodeCount = reader.Read<int32>();
+	tree.m_insertionCount = reader.Read<int32>();
+	for (int32 i = 0; i < nodeCapacity; ++i)
+	{
+		b2TreeNode& node = tree.m_nodes[i];
+		node.aabb = reader.Read<b2AABB>();
+		node.userData = nullptr;
+		node.parent = reader.Read<int32>();
+		node.child1 = reader.Read<int32>();
+		node.child2 = reader.Read<int32>();
+		node.height = reader.Read<int32>();
+		node.moved = reader.Read<bool>();
+	}
+
+	// Nodes past the snapshot's capacity go on the tail of the free list, which is where
+	// the original run would have found them after growing the pool.
+	if (tree.m_nodeCapacity > nodeCapacity)
+	{
+		for (int32 i = nodeCapacity; i < tree.m_nodeCapacity - 1; ++i)
+		{
+			tree.m_nodes[i].next = i + 1;
+			tree.m_nodes[i].height = -1;
+		}
+		tree.m_nodes[tree.m_nodeCapacity - 1].next = b2_nullNode;
+		tree.m_nodes[tree.m_nodeCapacity - 1].height = -1;
+
+		if (tree.m_freeList == b2_nullNode)
+		{
+			tree.m_freeList = nodeCapacity;
+		}
+		else
+		{
+			int32 tail = tree.m_freeList;
+			while (tree.m_nodes[tail].next != b2_nullNode)
+			{
+				tail = tree.m_nodes[tail].next;
+			}
+			tree.m_nodes[tail].next = nodeCapacity;
+		}
+	}
+
+	// Leaves point back at their fixture proxies.
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			for (int32 i = 0; i < f->m_proxyCount; ++i)
+			{
+				tree.m_nodes[f->m_proxies[i].proxyId].userData = f->m_proxies + i;
+			}
+		}
+	}
+
+	bp.m_proxyCount = reader.Read<int32>();
+	reader.Read<int32>();
+	if (bp.m_moveCapacity < moveCount)
+	{
+		b2Free(bp.m_moveBuffer);
+		bp.m_moveCapacity = moveCount;
+		bp.m_moveBuffer = (int32*)b2Alloc(moveCount * sizeof(int32));
+	}
+	bp.m_moveCount = moveCount;
+	for (int32 i = 0; i < moveCount; ++i)
+	{
+		bp.m_moveBuffer[i] = reader.Read<int32>();
+	}
+
+	// Recreate contacts oldest first so the world list and every body's edge list
+	// end up in the same order as when the snapshot was taken.
+	for (int32 i = contactCount - 1; i >= 0; --i)
+	{
+		reader.offset = contactOffset + i * int32(sizeof(b2ContactSnapshot));
+		b2ContactSnapshot cs = reader.Read<b2ContactSnapshot>();
+
+		b2FixtureProxy* proxyA = (b2FixtureProxy*)tree.m_nodes[cs.proxyIdA].userData;
+		b2FixtureProxy* proxyB = (b2FixtureProxy*)tree.m_nodes[cs.proxyIdB].userData;
+		b2Contact* contact = b2Contact::Create(proxyA->fixture, proxyA->childIndex, proxyB->fixture, proxyB->childIndex, &m_blockAllocator);
+		if (contact == nullptr)
+		{
+			continue;
+		}
+
+		contact->m_flags = cs.flags;
+		contact->m_manifold = cs.manifold;
+		contact->m_toiCount = cs.toiCount;
+		contact->m_toi = cs.toi;
+		contact->m_friction = cs.friction;
+		contact->m_restitution = cs.restitution;
+		contact->m_restitutionThreshold = cs.restitutionThreshold;
+		contact->m_tangentSpeed = cs.tangentSpeed;
+
+		b2Body* bodyA = contact->m_fixtureA->m_body;
+		b2Body* bodyB = contact->m_fixtureB->m_body;
+
+		contact->m_prev = nullptr;
+		contact->m_next = m_contactManager.m_contactList;
+		if (m_contactManager.m_contactList != nullptr)
+		{
+			m_contactManager.m_contactList->m_prev = contact;
+		}
+		m_contactManager.m_contactList = contact;
+
+		contact->m_nodeA.contact = contact;
+		contact->m_nodeA.other = bodyB;
+		contact->m_nodeA.prev = nullptr;
+		contact->m_nodeA.next = bodyA->m_contactList;
+		if (bodyA->m_contactList != nullptr)
+		{
+			bodyA->m_contactList->prev = &contact->m_nodeA;
+		}
+		bodyA->m_contactList = &contact->m_nodeA;
+
+		contact->m_nodeB.contact = contact;
+		contact->m_nodeB.other = bodyA;
+		contact->m_nodeB.prev = nullptr;
+		contact->m_nodeB.next = bodyB->m_contactList;
+		if (bodyB->m_contactList != nullptr)
+		{
+			bodyB->m_contactList->prev = &contact->m_nodeB;
+		}
+		bodyB->m_contactList = &contact->m_nodeB;
+
+		++m_contactManager.m_contactCount;
+	}
+
+	m_gravity = gravity;
+	m_inv_dt0 = inv_dt0;
+	m_allowSleep = allowSleep;
+	m_newContacts = newContacts;
+	m_clearForces = clearForces;
+	m_stepComplete = stepComplete;
+
+	return true;
+}
+
 void b2World::Dump()
 {
 	if (m_locked)
@@ -9,13 +9,18 @@
 #include "SceneDB.hpp"
 #include "TemplateDB.h"
 #include "Rigidbody.hpp"
+#include "Profiler.hpp"
+#include "Coroutines.hpp"
+#include "Logger.hpp"
+#include "ActorPool.hpp"
+#include "Region.hpp"
 
 void Actor::ReportError(std::string actor_name, const luabridge::LuaException& e) {
     std::string err_msg = e.what();
     
     std::replace(err_msg.begin(), err_msg.end(), '\\', '/');
     
-    std::cout << "\033[31m" << actor_name << " : " << err_msg << "\033[0m" << std::endl;
+    Logger::Write(LogLevel::Error, actor_name + " : " + err_msg, LogStyle::Highlight);
 }
     
 void Actor::InjectConvenienceReferences(std::shared_ptr<luabridge::LuaRef> component_ref)
@@ -56,7 +61,7 @@ luabridge::LuaRef Actor::FindAll(std::string name) {
 }
 
 Actor* Actor::Instantiate(std::string template_name) {
-    Actor* new_actor = new Actor(LoadActorFromTemplate(template_name));
+    Actor* new_actor = ActorPool::Spawn(template_name);
     for(auto& c : new_actor->components) {
         new_actor->InjectConvenienceReferences(c.second.componentRef);
     }
@@ -64,8 +69,13 @@ Actor* Actor::Instantiate(std::string template_name) {
     return new_actor;
 }
 
+bool Actor::IsDestroyed(Actor* actor) {
+    return to_destroy.find(actor) != to_destroy.end();
+}
+
 void Actor::Destroy(Actor* actor) {
     to_destroy.insert(actor);
+    Coroutines::CancelAll(actor);
     for(auto &c : actor->components) {
         (*c.second.componentRef)["enabled"] = false;
         actor->ondestroy_queue.push_back(c.first);
@@ -128,6 +138,7 @@ luabridge::LuaRef Actor::AddComponent(std::string type) {
 void Actor::RemoveComponent(luabridge::LuaRef component_ref) {
     component_ref["enabled"] = false;
     std::string key = component_ref["key"];
+    Coroutines::CancelAll(this, key);
     component_graveyard.insert(key);
     ondestroy_queue.push_back(key);
     return;
@@ -139,7 +150,10 @@ void Actor::OnStart() {
         luabridge::LuaRef OnStart_lua = (*components[c].componentRef)["OnStart"];
         if(components[c].enabled && !OnStart_lua.isNil()) {
             try {
+                ProfileScope scope(components[c].type, "OnStart");
                 OnStart_lua((*components[c].componentRef));
+                // OnStart may have set update_interval/update_priority
+                components[c].RefreshSchedule();
             } catch (const luabridge::LuaException& e){
                 ReportError(actor_name, e);
                 break;
@@ -150,12 +164,29 @@ void Actor::OnStart() {
 }
     
 void Actor::Update() {
+    if(!active) {
+        return;
+    }
     for(const auto & c : update_queue) {
-        components[c].enabled = (*components[c].componentRef)["enabled"];
-        luabridge::LuaRef OnUpdate_lua = (*components[c].componentRef)["OnUpdate"];
-        if(components[c].enabled && !OnUpdate_lua.isNil()) {
+        Component& component = components[c];
+        // Off-phase components skip the Lua lookups entirely
+        component.ticking = component.Due(update_frame);
+        if(!component.ticking) {
+            continue;
+        }
+        if(component.update_priority < 0 && !component.deferred && OverBudget()) {
+            component.deferred = true;
+            component.ticking = false;
+            ++deferred_count;
+            continue;
+        }
+        component.deferred = false;
+        component.enabled = (*component.componentRef)["enabled"];
+        luabridge::LuaRef OnUpdate_lua = (*component.componentRef)["OnUpdate"];
+        if(component.enabled && !OnUpdate_lua.isNil()) {
             try {
-                OnUpdate_lua((*components[c].componentRef));
+                ProfileScope scope(component.type, "OnUpdate");
+                OnUpdate_lua((*component.componentRef));
             } catch (const luabridge::LuaException& e){
                 ReportError(actor_name, e);
                 break;
@@ -165,15 +196,23 @@ void Actor::Update() {
 }
 
 void Actor::LateUpdate() {
-    for(const auto & c : lateupdate_queue) {
-        components[c].enabled = (*components[c].componentRef)["enabled"];
-        luabridge::LuaRef OnLateUpdate_lua = (*components[c].componentRef)["OnLateUpdate"];
-        if(components[c].enabled && !OnLateUpdate_lua.isNil()) {
-            try {
-                OnLateUpdate_lua((*components[c].componentRef));
-            } catch (const luabridge::LuaException& e){
-                ReportError(actor_name, e);
-                break;
+    // Checked once, as in Update; pending OnDestroy runs even while inactive
+    if(active) {
+        for(const auto & c : lateupdate_queue) {
+            Component& component = components[c];
+            if(!component.ticking) {
+                continue;
+            }
+            component.enabled = (*component.componentRef)["enabled"];
+            luabridge::LuaRef OnLateUpdate_lua = (*component.componentRef)["OnLateUpdate"];
+            if(component.enabled && !OnLateUpdate_lua.isNil()) {
+                try {
+                    ProfileScope scope(component.type, "OnLateUpdate");
+                    OnLateUpdate_lua((*component.componentRef));
+                } catch (const luabridge::LuaException& e){
+                    ReportError(actor_name, e);
+                    break;
+                }
             }
         }
     }
@@ -252,6 +291,34 @@ void Actor::OnTriggerExit(Collision collision) {
     }
 }
 
+void Actor::OnActivate() {
+    for(const auto & c : components) {
+        luabridge::LuaRef OnActivate_lua = (*c.second.componentRef)["OnActivate"];
+        if((c.second.enabled) && !OnActivate_lua.isNil()) {
+            try {
+                OnActivate_lua(*c.second.componentRef);
+            } catch (const luabridge::LuaException& e){
+                ReportError(actor_name, e);
+                break;
+            }
+        }
+    }
+}
+
+void Actor::OnDeactivate() {
+    for(const auto & c : components) {
+        luabridge::LuaRef OnDeactivate_lua = (*c.second.componentRef)["OnDeactivate"];
+        if((c.second.enabled) && !OnDeactivate_lua.isNil()) {
+            try {
+                OnDeactivate_lua(*c.second.componentRef);
+            } catch (const luabridge::LuaException& e){
+                ReportError(actor_name, e);
+                break;
+            }
+        }
+    }
+}
+
 void Actor::IndividualFrameEnd() {
     for(const auto & c : addcomponent_queue) {
         components[(*c)["key"]] = Component((*c)["key"], (*c)["type"], c);
@@ -279,19 +346,61 @@ void Actor::IndividualFrameEnd() {
 }
 
 void Actor::FrameEnd() {
+    // Activation changes from bodies removed this frame; may destroy or instantiate more
+    Region::RefreshActors();
     for(const auto & a : to_instantiate) {
         actors.push_back(a);
         n_actors++;
     }
     to_instantiate.clear();
     
-    for(const auto & a : actors) {
-        auto it = std::find(actors.begin(), actors.end(), a);
-
-        if (to_destroy.find(a) != to_destroy.end() && it != actors.end()) {
-            actors.erase(it);
+    // Erase through the iterator; erasing under a range-for skipped the next actor
+    for(auto it = actors.begin(); it != actors.end();) {
+        Actor* a = *it;
+        if (to_destroy.find(a) == to_destroy.end()) {
+            ++it;
+            continue;
+        }
+        it = actors.erase(it);
+        // Destroyed after its own LateUpdate; its OnDestroy is still queued
+        a->OnDestroy();
+        if(!ActorPool::Release(a)) {
             delete a;
         }
     }
     to_destroy.clear();
+    ++update_frame;
+}
+
+void Actor::InitializeSchedule() {
+    if(config.HasMember("script_budget_ms")) {
+        script_budget_ms = config["script_budget_ms"].GetFloat();
+    }
+}
+
+void Actor::BeginUpdate() {
+    deferred_count = 0;
+    if(script_budget_ms > 0.0f) {
+        update_start = std::chrono::steady_clock::now();
+    }
+}
+
+bool Actor::OverBudget() {
+    if(script_budget_ms <= 0.0f) {
+        return false;
+    }
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - update_start;
+    return elapsed.count() > script_budget_ms;
+}
+
+void Actor::SetScriptBudget(float ms) {
+    script_budget_ms = ms;
+}
+
+float Actor::GetScriptBudget() {
+    return script_budget_ms;
+}
+
+int Actor::GetDeferredCount() {
+    return deferred_count;
 }
@@ -10,6 +10,7 @@
 
 #include <stdio.h>
 #include <string>
+#include <chrono>
 #include <map>
 #include <unordered_set>
 #include "ComponentDB.hpp"
@@ -30,12 +31,27 @@ private:
     std::unordered_set<std::string> component_graveyard;
     
     void IndividualFrameEnd();
+    friend class ActorPool;
+    
+    // Frame-budgeted ticking
+    static inline int update_frame = 0;
+    static inline float script_budget_ms = 0.0f; // <= 0 turns the budget off
+    static inline int deferred_count = 0;
+    static inline std::chrono::steady_clock::time_point update_start;
+    static bool OverBudget();
     
 public:
     int actor_id;
     std::string actor_name;
     std::string actor_template;
     bool donotdestroy = false;
+    std::string pool_template; // set when spawned from a pooled template
+    std::string stream_chunk; // set while owned by a streamed chunk
+    
+    // Regional simulation: inactive actors skip Update/LateUpdate
+    bool active = true;
+    int region_bodies = 0;
+    int region_bodies_inside = 0;
     
     std::map<std::string, Component> components;
     std::vector<std::string> onstart_queue;
@@ -55,6 +71,12 @@ public:
     void InjectConvenienceReferences(std::shared_ptr<luabridge::LuaRef> component_ref);
     static void FrameEnd();
     
+    static void InitializeSchedule();
+    static void BeginUpdate();
+    static void SetScriptBudget(float ms);
+    static float GetScriptBudget();
+    static int GetDeferredCount();
+    
     static luabridge::LuaRef Find(std::string name);
     
     static luabridge::LuaRef FindAll(std::string name);
@@ -62,6 +84,7 @@ public:
     static Actor* Instantiate(std::string template_name);
     
     static void Destroy(Actor* actor);
+    static bool IsDestroyed(Actor* actor);
     
     std::string GetName();
     
@@ -90,6 +113,9 @@ public:
     
     void OnTriggerEnter(Collision collision);
     void OnTriggerExit(Collision collision);
+    
+    void OnActivate();
+    void OnDeactivate();
 };
 
 #endif /* Actor_hpp */
@@ -0,0 +1,152 @@
+//
+//  ActorPool.cpp
+//  game_engine
+//
+//  Created by Jasmine Li on 4/29/24.
+//
+
+#include "ActorPool.hpp"
+#include "TemplateDB.h"
+#include "Rigidbody.hpp"
+
+const ActorPrototype* ActorPool::PooledPrototype(const std::string& template_name) {
+    auto prototype = prototypes.find(template_name);
+    if(prototype == prototypes.end() || prototype->second.pool <= 0) {
+        return nullptr;
+    }
+    return &prototype->second;
+}
+
+Actor* ActorPool::Spawn(const std::string& template_name) {
+    auto pool = pools.find(template_name);
+    if(pool != pools.end() && !pool->second.empty()) {
+        Actor* actor = pool->second.back();
+        pool->second.pop_back();
+        actor->actor_id = n_actors;
+        ++hits;
+        return actor;
+    }
+    Actor* actor = new Actor(LoadActorFromTemplate(template_name));
+    if(PooledPrototype(template_name) != nullptr) {
+        actor->pool_template = template_name;
+        ++misses;
+    }
+    return actor;
+}
+
+bool ActorPool::Release(Actor* actor) {
+    if(actor->pool_template.empty()) {
+        return false;
+    }
+    const ActorPrototype* prototype = PooledPrototype(actor->pool_template);
+    std::vector<Actor*>& pool = pools[actor->pool_template];
+    if(prototype == nullptr || static_cast<int>(pool.size()) >= prototype->pool || !Recycle(actor, *prototype)) {
+        ++dropped;
+        DiscardBodies(actor);
+        return false;
+    }
+    pool.push_back(actor);
+    return true;
+}
+
+bool ActorPool::Recycle(Actor* actor, const ActorPrototype& prototype) {
+    // Only actors that still have the template's components can be reused
+    if(!actor->addcomponent_queue.empty() || actor->components.size() != prototype.components.size()) {
+        return false;
+    }
+    for(const ComponentPrototype& c : prototype.components) {
+        auto component = actor->components.find(c.key);
+        if(component == actor->components.end() || component->second.type != c.type) {
+            return false;
+        }
+    }
+
+    actor->onstart_queue.clear();
+    actor->update_queue.clear();
+    actor->lateupdate_queue.clear();
+    for(const ComponentPrototype& c : prototype.components) {
+        Component& component = actor->components[c.key];
+        if(c.table) {
+            ComponentDB::ResetComponentInstance(*c.table, *component.componentRef);
+        } else {
+            ComponentDB::OverrideComponentInstance(component.componentRef, *c.json);
+            (*component.componentRef)["enabled"] = true;
+        }
+        component.enabled = true;
+        component.deferred = false;
+        component.ticking = true;
+        component.RefreshSchedule();
+        actor->onstart_queue.push_back(c.key);
+        actor->update_queue.push_back(c.key);
+        actor->lateupdate_queue.push_back(c.key);
+    }
+    actor->component_graveyard.clear();
+    actor->actor_name = prototype.name;
+    actor->donotdestroy = false;
+    actor->active = true;
+    actor->region_bodies = 0;
+    actor->region_bodies_inside = 0;
+
+    // Scripts reset whatever else they keep on self
+    for(const ComponentPrototype& c : prototype.components) {
+        std::shared_ptr<luabridge::LuaRef> component_ref = actor->components[c.key].componentRef;
+        luabridge::LuaRef OnRecycle_lua = (*component_ref)["OnRecycle"];
+        if(!OnRecycle_lua.isNil()) {
+            try {
+                OnRecycle_lua(*component_ref);
+            } catch (const luabridge::LuaException& e){
+                actor->ReportError(actor->actor_name, e);
+            }
+        }
+    }
+    return true;
+}
+
+void ActorPool::DiscardBodies(Actor* actor) {
+    for(auto& c : actor->components) {
+        if(c.second.type == "Rigidbody") {
+            c.second.componentRef->cast<Rigidbody*>()->DestroyBody();
+        }
+    }
+}
+
+void ActorPool::Clear() {
+    // Parked bodies go with the world reset that follows a scene load
+    for(auto& [template_name, pool] : pools) {
+        for(Actor* actor : pool) {
+            delete actor;
+        }
+    }
+    pools.clear();
+}
+
+void ActorPool::Prewarm(std::string template_name, int count) {
+    for(int i = 0; i < count; ++i) {
+        Actor* actor = new Actor(LoadActorFromTemplate(template_name));
+        const ActorPrototype* prototype = PooledPrototype(template_name);
+        std::vector<Actor*>& pool = pools[template_name];
+        if(prototype == nullptr || static_cast<int>(pool.size()) >= prototype->pool) {
+            delete actor;
+            return;
+        }
+        actor->pool_template = template_name;
+        pool.push_back(actor);
+    }
+}
+
+int ActorPool::GetAvailable(std::string template_name) {
+    auto pool = pools.find(template_name);
+    return pool == pools.end() ? 0 : static_cast<int>(pool->second.size());
+}
+
+int ActorPool::GetHits() {
+    return hits;
+}
+
+int ActorPool::GetMisses() {
+    return misses;
+}
+
+int ActorPool::GetDropped() {
+    return dropped;
+}
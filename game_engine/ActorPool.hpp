@@ -0,0 +1,46 @@
+//
+//  ActorPool.hpp
+//  game_engine
+//
+//  Created by Jasmine Li on 4/29/24.
+//
+
+#ifndef ActorPool_hpp
+#define ActorPool_hpp
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class Actor;
+struct ActorPrototype;
+
+// Opt-in reuse of destroyed actors for templates with "pool": N. Released
+// actors get their component fields restored from the template prototype,
+// then OnRecycle(self) runs; their Rigidbodies stay parked (disabled) until the
+// next OnStart. Templates that inherit another template are never pooled.
+class ActorPool {
+public:
+    static Actor* Spawn(const std::string& template_name);
+    static bool Release(Actor* actor);
+    static void Clear();
+
+    static void Prewarm(std::string template_name, int count);
+    static int GetAvailable(std::string template_name);
+    static int GetHits();
+    static int GetMisses();
+    static int GetDropped();
+
+private:
+    static inline std::unordered_map<std::string, std::vector<Actor*>> pools;
+    static inline int hits = 0;
+    static inline int misses = 0;
+    static inline int dropped = 0;
+
+    static const ActorPrototype* PooledPrototype(const std::string& template_name);
+    static bool Recycle(Actor* actor, const ActorPrototype& prototype);
+    static void DiscardBodies(Actor* actor);
+};
+
+#endif /* ActorPool_hpp */
@@ -5,8 +5,12 @@
 //  Created by Jasmine Li on 4/15/24.
 //
 
+#include <chrono>
+#include <cstdlib>
 #include "Animation.hpp"
 #include "SceneDB.hpp"
+#include "AssetManifest.hpp"
+#include "TextureCache.hpp"
 
 AnimAtlasFile::AnimAtlasFile(std::string initialFilePath) :
         AtlasFile(initialFilePath) {}
@@ -14,17 +18,13 @@ void AnimAtlasFile::renderSprite(SpriterEngine::UniversalObjectInterface *sprite
 
 AnimImageFile::AnimImageFile(std::string initialFilePath, SpriterEngine::point initialDefaultPivot)
     : ImageFile(initialFilePath, initialDefaultPivot) {
-        std::filesystem::path image_name = initialFilePath;
-        image_name.replace_extension("");
-        if(Image::loaded_imgs.find(image_name) == Image::loaded_imgs.end()) {
-            std::filesystem::path path = resources/"images"/(image_name.string() +".png");
-            if(!std::filesystem::exists(path)) {
-                std::cout << "error: missing image " + image_name.string();
-                exit(0);
-            }
-            Image::loaded_imgs[image_name] = IMG_LoadTexture(Scene::renderer, path.string().c_str());
-        }
-        texture = Image::loaded_imgs[image_name];
+        image_name = std::filesystem::path(initialFilePath).replace_extension("").string();
+        texture = Image::Load(image_name);
+        // The model keeps the pointer, so the cache must not evict it
+        TextureCache::Pin(image_name);
+}
+AnimImageFile::~AnimImageFile() {
+    TextureCache::Unpin(image_name);
 }
 void AnimImageFile::renderSprite(SpriterEngine::UniversalObjectInterface *spriteInfo) {
 
@@ -288,10 +288,11 @@ SpriterEngine::SpriterFileElementWrapper* AnimSpriterFileElementWrapper::newElem
 void AnimSpriterFileDocumentWrapper::loadFile(std::string fileName) {
     std::filesystem::path path = resources/"animations"/(fileName);
     if(!std::filesystem::exists(path)) {
+        Logger::Flush();
         std::cout << "error: missing animation file " + fileName;
         exit(0);
     }
-    EngineUtils::ReadJsonFile(path, doc);
+    EngineUtils::StreamJsonFile(path.generic_string(), doc);
 }
 SpriterEngine::SpriterFileElementWrapper* AnimSpriterFileDocumentWrapper::newElementWrapperFromFirstElement() {
     if (doc.IsObject() && !doc.ObjectEmpty()) {
@@ -324,10 +325,63 @@ AnimSpriterFileDocumentWrapper* AnimFileFactory::newSconDocumentWrapper(){
     return new AnimSpriterFileDocumentWrapper();
 }
 
+void AnimationDB::Initialize() {
+    std::atexit(Report);
+}
+
+SpriterEngine::EntityInstance* AnimationDB::NewInstance(const std::string& file) {
+    Acquire(file);
+    ++instances_created;
+    ++live_instances;
+    return models[file].model->getNewEntityInstance(0);
+}
+
+// Instances reference the model's files, so they go before it
+void AnimationDB::DeleteInstance(const std::string& file, SpriterEngine::EntityInstance* instance) {
+    delete instance;
+    --live_instances;
+    Release(file);
+}
+
+void AnimationDB::Acquire(const std::string& file) {
+    CachedModel& cached = models[file];
+    if(cached.refs++ > 0) {
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    AssetManifest::Loaded();
+    // The model owns the factory
+    cached.model = new SpriterEngine::SpriterModel(file, new AnimFileFactory());
+    parse_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ++models_built;
+}
+
+void AnimationDB::Release(const std::string& file) {
+    auto cached = models.find(file);
+    if(cached == models.end() || --cached->second.refs > 0) {
+        return;
+    }
+    delete cached->second.model;
+    models.erase(cached);
+}
+
+void AnimationDB::Report() {
+    if(EngineUtils::GetEnvVariable("ANIMATION_REPORT").empty()) {
+        return;
+    }
+    Logger::Flush();
+    std::cout << "animation: " << models_built << " models built in " << parse_ms << " ms, " << instances_created << " instances, " << models.size() << " models " << live_instances << " instances live" << std::endl;
+}
+
 void AnimationComponent::Ready() {
-    fileFactory = new AnimFileFactory();
-    model = new SpriterEngine::SpriterModel(file, fileFactory);
-    entityInstance = model->getNewEntityInstance(0);
+    AssetManifest::Requested(AssetKind::Animation, file);
+    SpriterEngine::EntityInstance* instance = AnimationDB::NewInstance(file);
+    // Recycled (pooled) actors start again; the new instance keeps the model alive
+    if(entityInstance != nullptr) {
+        OnDestroy();
+    }
+    model_file = file;
+    entityInstance = instance;
 }
 
 void AnimationComponent::OnUpdate() {
@@ -343,6 +397,16 @@ void AnimationComponent::OnUpdate() {
 }
 
 void AnimationComponent::OnDestroy() {
+    if(entityInstance == nullptr) {
+        return;
+    }
+    auto rendering = AnimationDB::to_render.find(key);
+    if(rendering != AnimationDB::to_render.end() && rendering->second == entityInstance) {
+        AnimationDB::to_render.erase(rendering);
+    }
+    AnimationDB::DeleteInstance(model_file, entityInstance);
+    entityInstance = nullptr;
+    internalTime = -1;
 }
 
 void AnimationComponent::Play(std::string anim_name) {
@@ -9,6 +9,7 @@
 #define Animation_hpp
 
 #include <stdio.h>
+#include <unordered_map>
 #include "spriterengine.h"
 #include "spriterengine/override/filefactory.h"
 #include "spriterengine/override/imagefile.h"
@@ -24,9 +25,11 @@ inline float deltaTime = 1000.0f/60;
 class AnimImageFile : public SpriterEngine::ImageFile {
 public:
     AnimImageFile(std::string initialFilePath, SpriterEngine::point initialDefaultPivot);
+    ~AnimImageFile();
     void renderSprite(SpriterEngine::UniversalObjectInterface *spriteInfo) override;
     void setAtlasFile(SpriterEngine::AtlasFile* initialAtlasFile, SpriterEngine::atlasframedata initialAtlasFrameData) override;
 private:
+    std::string image_name;
     SDL_Texture* texture;
 };
 
@@ -148,16 +151,36 @@ public:
     
 private:
     float internalTime = -1;
-    AnimFileFactory* fileFactory;
-    SpriterEngine::SpriterModel* model;
-    SpriterEngine::EntityInstance* entityInstance;
+    std::string model_file; // file the instance came from, in case file is changed
+    SpriterEngine::EntityInstance* entityInstance = nullptr;
     
     std::unordered_set<std::string> animation_names;
 };
 
+// One SpriterModel per animation file, shared by every component playing it.
+// Instances and prefetch holds keep a model alive; it is freed with the last.
+// Set ANIMATION_REPORT to print models built, parse time and instances at exit.
 class AnimationDB {
 public:
     static inline std::map<std::string, SpriterEngine::EntityInstance*> to_render;
+
+    static void Initialize();
+    static SpriterEngine::EntityInstance* NewInstance(const std::string& file);
+    static void DeleteInstance(const std::string& file, SpriterEngine::EntityInstance* instance);
+    static void Acquire(const std::string& file);
+    static void Release(const std::string& file);
+    static void Report();
+
+private:
+    struct CachedModel {
+        SpriterEngine::SpriterModel* model = nullptr;
+        int refs = 0;
+    };
+    static inline std::unordered_map<std::string, CachedModel> models;
+    static inline int models_built = 0;
+    static inline int instances_created = 0;
+    static inline int live_instances = 0;
+    static inline double parse_ms = 0;
 };
 
 #endif /* Animation_hpp */
@@ -0,0 +1,187 @@
+//
+//  AssetManifest.cpp
+//  game_engine
+//
+//  Created by Jasmine Li on 5/3/24.
+//
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+#include "AssetManifest.hpp"
+#include "SceneDB.hpp"
+#include "ImageDB.hpp"
+#include "AudioDB.hpp"
+#include "TextDB.hpp"
+#include "Animation.hpp"
+
+void AssetManifest::Initialize() {
+    std::string mode = EngineUtils::GetEnvVariable("ASSET_MANIFEST");
+    enabled = mode != "off";
+    recording = mode == "record";
+    // Scripts and errors leave through exit(), so save from there
+    std::atexit([] {
+        Save();
+        Report();
+    });
+}
+
+std::string AssetManifest::ManifestPath(const std::string& scene_name) {
+    return (resources / "scenes" / (scene_name + ".manifest")).generic_string();
+}
+
+// A missing or unreadable manifest is just empty
+bool AssetManifest::Read(const std::string& scene_name, Manifest& manifest) {
+    std::ifstream in(ManifestPath(scene_name), std::ios::binary);
+    if(!in) {
+        return false;
+    }
+    std::stringstream contents;
+    contents << in.rdbuf();
+    rapidjson::Document doc;
+    doc.Parse(contents.str().c_str());
+    if(doc.HasParseError() || !doc.IsObject()) {
+        return false;
+    }
+    auto strings = [&doc](const char* key, std::set<std::string>& out) {
+        if(doc.HasMember(key) && doc[key].IsArray()) {
+            for(auto& v : doc[key].GetArray()) {
+                if(v.IsString()) {
+                    out.insert(v.GetString());
+                }
+            }
+        }
+    };
+    strings("images", manifest.images);
+    strings("audio", manifest.audio);
+    strings("animations", manifest.animations);
+    if(doc.HasMember("fonts") && doc["fonts"].IsArray()) {
+        for(auto& f : doc["fonts"].GetArray()) {
+            if(f.IsObject() && f.HasMember("name") && f["name"].IsString() && f.HasMember("size") && f["size"].IsInt()) {
+                manifest.fonts.insert({f["name"].GetString(), f["size"].GetInt()});
+            }
+        }
+    }
+    return true;
+}
+
+void AssetManifest::ReadNames(const std::string& scene_name, std::vector<std::string>& images, std::vector<std::string>& clips) {
+    // Not `enabled`: this can run before Initialize
+    if(EngineUtils::GetEnvVariable("ASSET_MANIFEST") == "off") {
+        return;
+    }
+    Manifest manifest;
+    Read(scene_name, manifest);
+    images.insert(images.end(), manifest.images.begin(), manifest.images.end());
+    clips.insert(clips.end(), manifest.audio.begin(), manifest.audio.end());
+}
+
+void AssetManifest::Record(AssetKind kind, const std::string& name, int size) {
+    if(current_scene.empty()) {
+        return;
+    }
+    Manifest& manifest = recorded[current_scene];
+    bool added = false;
+    switch(kind) {
+        case AssetKind::Image: added = manifest.images.insert(name).second; break;
+        case AssetKind::Audio: added = manifest.audio.insert(name).second; break;
+        case AssetKind::Font: added = manifest.fonts.insert({name, size}).second; break;
+        case AssetKind::Animation: added = manifest.animations.insert(name).second; break;
+    }
+    manifest.dirty = manifest.dirty || added;
+}
+
+void AssetManifest::Prefetch(const std::string& scene_name) {
+    Save();
+    current_scene = scene_name;
+    Manifest manifest;
+    Read(scene_name, manifest);
+    if(recording && recorded.find(scene_name) == recorded.end()) {
+        // Record on top of earlier sessions
+        recorded[scene_name] = manifest;
+        recorded[scene_name].dirty = false;
+    }
+    if(!enabled) {
+        return;
+    }
+    // Entries whose file has since been removed are skipped, not errors
+    prefetching = true;
+    for(const std::string& name : manifest.images) {
+        if(std::filesystem::exists(resources / "images" / (name + ".png"))) {
+            Image::Load(name);
+        }
+    }
+    for(const std::string& name : manifest.audio) {
+        if(std::filesystem::exists(resources / "audio" / (name + ".wav")) || std::filesystem::exists(resources / "audio" / (name + ".ogg"))) {
+            Audio::Load(name);
+        }
+    }
+    for(const auto& [name, size] : manifest.fonts) {
+        if(std::filesystem::exists(resources / "fonts" / (name + ".ttf"))) {
+            Text::LoadFont(name, size);
+        }
+    }
+    // Models are held for the scene; the previous scene's go once these are built
+    std::vector<std::string> animations;
+    for(const std::string& name : manifest.animations) {
+        if(std::filesystem::exists(resources / "animations" / name)) {
+            AnimationDB::Acquire(name);
+            animations.push_back(name);
+        }
+    }
+    for(const std::string& name : held_animations) {
+        AnimationDB::Release(name);
+    }
+    held_animations = animations;
+    prefetching = false;
+}
+
+void AssetManifest::Save() {
+    for(auto& [scene_name, manifest] : recorded) {
+        if(!manifest.dirty) {
+            continue;
+        }
+        rapidjson::StringBuffer buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        auto strings = [&writer](const char* key, const std::set<std::string>& values) {
+            writer.Key(key);
+            writer.StartArray();
+            for(const std::string& v : values) {
+                writer.String(v.c_str());
+            }
+            writer.EndArray();
+        };
+        writer.StartObject();
+        strings("images", manifest.images);
+        strings("audio", manifest.audio);
+        writer.Key("fonts");
+        writer.StartArray();
+        for(const auto& [name, size] : manifest.fonts) {
+            writer.StartObject();
+            writer.Key("name");
+            writer.String(name.c_str());
+            writer.Key("size");
+            writer.Int(size);
+            writer.EndObject();
+        }
+        writer.EndArray();
+        strings("animations", manifest.animations);
+        writer.EndObject();
+
+        std::ofstream out(ManifestPath(scene_name), std::ios::binary | std::ios::trunc);
+        if(out) {
+            out << buffer.GetString() << std::endl;
+            manifest.dirty = false;
+        }
+    }
+}
+
+void AssetManifest::Report() {
+    if(EngineUtils::GetEnvVariable("ASSET_MANIFEST_REPORT").empty()) {
+        return;
+    }
+    Logger::Flush();
+    std::cout << "asset manifest: " << prefetched << " prefetched " << on_demand << " on demand" << std::endl;
+}
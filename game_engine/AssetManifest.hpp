@@ -0,0 +1,72 @@
+//
+//  AssetManifest.hpp
+//  game_engine
+//
+//  Created by Jasmine Li on 5/3/24.
+//
+
+#ifndef AssetManifest_hpp
+#define AssetManifest_hpp
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+
+enum class AssetKind { Image, Audio, Font, Animation };
+
+// Per-scene prefetch lists. Run with ASSET_MANIFEST=record and every image,
+// clip, font and animation requested while a scene is current is written to
+// scenes/<scene>.manifest (merged with what is already there). On load the
+// manifest's assets are loaded up front so nothing is read on first use.
+// ASSET_MANIFEST=off skips prefetching; ASSET_MANIFEST_REPORT prints how many
+// assets were prefetched and how many were still loaded on demand.
+class AssetManifest {
+public:
+    static void Initialize();
+    static void Prefetch(const std::string& scene_name);
+    static void Save();
+    static void Report();
+
+    static void Requested(AssetKind kind, const std::string& name, int size = 0) {
+        if(recording) {
+            Record(kind, name, size);
+        }
+    }
+    // Called by the loaders whenever a file is actually read
+    static void Loaded() {
+        if(prefetching) {
+            ++prefetched;
+        } else {
+            ++on_demand;
+        }
+    }
+
+    // Image and audio names only; safe off the main thread
+    static void ReadNames(const std::string& scene_name, std::vector<std::string>& images, std::vector<std::string>& clips);
+
+private:
+    struct Manifest {
+        std::set<std::string> images;
+        std::set<std::string> audio;
+        std::set<std::pair<std::string, int>> fonts;
+        std::set<std::string> animations;
+        bool dirty = false;
+    };
+
+    static inline bool enabled = true;
+    static inline bool recording = false;
+    static inline bool prefetching = false;
+    static inline std::string current_scene;
+    static inline std::unordered_map<std::string, Manifest> recorded;
+    static inline std::vector<std::string> held_animations;
+    static inline int prefetched = 0;
+    static inline int on_demand = 0;
+
+    static void Record(AssetKind kind, const std::string& name, int size);
+    static bool Read(const std::string& scene_name, Manifest& manifest);
+    static std::string ManifestPath(const std::string& scene_name);
+};
+
+#endif /* AssetManifest_hpp */
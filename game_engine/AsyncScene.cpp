@@ -0,0 +1,305 @@
+//
+//  AsyncScene.cpp
+//  game_engine
+//
+//  Created by Jasmine Li on 4/30/24.
+//
+
+#include <chrono>
+#include <queue>
+#include "AsyncScene.hpp"
+#include "SceneDB.hpp"
+#include "TemplateDB.h"
+#include "ImageDB.hpp"
+#include "AudioDB.hpp"
+#include "SceneBinary.hpp"
+#include "AssetManifest.hpp"
+#include "TextureCache.hpp"
+
+void AsyncScene::Initialize() {
+    if(config.HasMember("async_load_budget_ms")) {
+        budget_ms = config["async_load_budget_ms"].GetFloat();
+    }
+    std::atexit(Shutdown);
+}
+
+void AsyncScene::Load(std::string scene_name) {
+    if (!std::filesystem::exists(resources / "scenes" / (scene_name + ".scene"))) {
+        Logger::Flush();
+        std::cout << "error: scene " << scene_name << " is missing";
+        exit(0);
+    }
+    if(phase != Phase::Idle) {
+        if(loading_scene == scene_name) {
+            return;
+        }
+        Cancel();
+    }
+    loading_scene = scene_name;
+    known_templates.clear();
+    for(auto& t : templates) {
+        known_templates.insert(t.first);
+    }
+    known_images.clear();
+    for(const std::string& image : TextureCache::GetNames()) {
+        known_images.insert(image);
+    }
+    known_clips.clear();
+    for(const std::string& clip : Audio::GetClipNames()) {
+        known_clips.insert(clip);
+    }
+    cancelled = false;
+    read_done = false;
+    error.clear();
+    assets_total = 0;
+    assets_done = 0;
+    phase = Phase::Reading;
+    worker = std::thread(Read);
+}
+
+// Component string fields naming a file in images/ or audio/
+void AsyncScene::CollectAssets(rapidjson::Value& actor, std::unordered_set<std::string>& image_names, std::unordered_set<std::string>& clip_names) {
+    if(!actor.HasMember("components")) {
+        return;
+    }
+    for (auto& c : actor["components"].GetObject()) {
+        for (auto& field : c.value.GetObject()) {
+            if(!field.value.IsString()) {
+                continue;
+            }
+            std::string name = field.value.GetString();
+            if(name.empty()) {
+                continue;
+            }
+            if(known_images.find(name) == known_images.end() && std::filesystem::exists(resources / "images" / (name + ".png"))) {
+                image_names.insert(name);
+            }
+            if(known_clips.find(name) == known_clips.end() && (std::filesystem::exists(resources / "audio" / (name + ".wav")) || std::filesystem::exists(resources / "audio" / (name + ".ogg")))) {
+                clip_names.insert(name);
+            }
+        }
+    }
+}
+
+void AsyncScene::Read() {
+    scene = std::make_unique<rapidjson::Document>();
+    std::string scene_path = (resources / "scenes" / (loading_scene + ".scene")).generic_string();
+    if(!EngineUtils::ParseJsonFile(scene_path, *scene)) {
+        Fail(EngineUtils::JsonError(scene_path, *scene));
+        return;
+    }
+
+    std::unordered_set<std::string> image_names;
+    std::unordered_set<std::string> clip_names;
+    std::unordered_set<std::string> visited = known_templates;
+    std::queue<std::string> pending;
+    for (auto& a : (*scene)["actors"].GetArray()) {
+        CollectAssets(a, image_names, clip_names);
+        if(a.HasMember("template") && visited.insert(a["template"].GetString()).second) {
+            pending.push(a["template"].GetString());
+        }
+    }
+    // Templates, and the templates they inherit
+    while(!pending.empty() && !cancelled.load(std::memory_order_relaxed)) {
+        std::string name = pending.front();
+        pending.pop();
+        std::filesystem::path path = resources / "actor_templates" / (name + ".template");
+        if(!std::filesystem::exists(path)) {
+            // Reported by the main thread when the actor is built
+            continue;
+        }
+        std::unique_ptr<rapidjson::Document> doc = std::make_unique<rapidjson::Document>();
+        if(!EngineUtils::ParseJsonFile(path.generic_string(), *doc)) {
+            Fail(EngineUtils::JsonError(path.generic_string(), *doc));
+            return;
+        }
+        CollectAssets(*doc, image_names, clip_names);
+        if(doc->HasMember("template") && visited.insert((*doc)["template"].GetString()).second) {
+            pending.push((*doc)["template"].GetString());
+        }
+        template_docs.emplace_back(name, std::move(doc));
+    }
+
+    // Plus whatever the scene's manifest says scripts will ask for
+    std::vector<std::string> manifest_images;
+    std::vector<std::string> manifest_clips;
+    AssetManifest::ReadNames(loading_scene, manifest_images, manifest_clips);
+    for(const std::string& name : manifest_images) {
+        if(known_images.find(name) == known_images.end() && std::filesystem::exists(resources / "images" / (name + ".png"))) {
+            image_names.insert(name);
+        }
+    }
+    for(const std::string& name : manifest_clips) {
+        if(known_clips.find(name) == known_clips.end()) {
+            clip_names.insert(name);
+        }
+    }
+
+    assets_total = static_cast<int>(image_names.size() + clip_names.size());
+    for(const std::string& name : image_names) {
+        if(cancelled.load(std::memory_order_relaxed)) {
+            break;
+        }
+        SDL_Surface* surface = IMG_Load((resources / "images" / (name + ".png")).string().c_str());
+        if(surface != nullptr) {
+            images.push_back({name, surface});
+        }
+        ++assets_done;
+    }
+    for(const std::string& name : clip_names) {
+        if(cancelled.load(std::memory_order_relaxed)) {
+            break;
+        }
+        std::filesystem::path wav = resources / "audio" / (name + ".wav");
+        std::filesystem::path path = std::filesystem::exists(wav) ? wav : resources / "audio" / (name + ".ogg");
+        Mix_Chunk* chunk = AudioHelper::Mix_LoadWAV498(path.string().c_str());
+        if(chunk != nullptr) {
+            clips.push_back({name, chunk});
+        }
+        ++assets_done;
+    }
+    read_done.store(true, std::memory_order_release);
+}
+
+// Errors are reported, and the process exits, from the main thread
+void AsyncScene::Fail(const std::string& message) {
+    error = message;
+    read_done.store(true, std::memory_order_release);
+}
+
+void AsyncScene::Update() {
+    if(phase == Phase::Idle) {
+        return;
+    }
+    if(phase == Phase::Reading) {
+        if(!read_done.load(std::memory_order_acquire)) {
+            return;
+        }
+        worker.join();
+        if(!error.empty()) {
+            Logger::Flush();
+            std::cout << error << std::endl;
+            exit(0);
+        }
+        phase = Phase::Installing;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::duration<float, std::milli> elapsed;
+    do {
+        if(!Step()) {
+            Switch();
+            return;
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while(elapsed.count() < budget_ms);
+}
+
+// One unit of main-thread work; false once every actor is built
+bool AsyncScene::Step() {
+    if(phase == Phase::Installing) {
+        if(next_template < template_docs.size()) {
+            auto& [name, doc] = template_docs[next_template++];
+            InstallTemplate(name, std::move(doc));
+            return true;
+        }
+        if(next_image < images.size()) {
+            DecodedImage& image = images[next_image++];
+            if(!TextureCache::Reference(image.name, loading_scene)) {
+                TextureCache::Insert(image.name, SDL_CreateTextureFromSurface(Scene::renderer, image.surface), loading_scene);
+            }
+            SDL_FreeSurface(image.surface);
+            image.surface = nullptr;
+            return true;
+        }
+        if(next_clip < clips.size()) {
+            DecodedClip& clip = clips[next_clip++];
+            Audio::AddClip(clip.name, clip.chunk);
+            clip.chunk = nullptr;
+            return true;
+        }
+        phase = Phase::Staging;
+    }
+    rapidjson::Value& scene_actors = (*scene)["actors"];
+    if(staged.size() < scene_actors.Size()) {
+        staged.push_back(new Actor(CreateActor(scene_actors[static_cast<rapidjson::SizeType>(staged.size())])));
+        return true;
+    }
+    return false;
+}
+
+void AsyncScene::Switch() {
+    Scene::UnloadActors();
+    for(Actor* actor : staged) {
+        actor->actor_id = n_actors++;
+        actors.push_back(actor);
+    }
+    staged.clear();
+    Scene::current_scene = loading_scene;
+    SceneBinary::Compile(loading_scene, *scene);
+    Scene::FinishLoad(loading_scene);
+    Discard();
+}
+
+void AsyncScene::Cancel() {
+    if(phase == Phase::Idle) {
+        return;
+    }
+    cancelled = true;
+    if(worker.joinable()) {
+        worker.join();
+    }
+    for(Actor* actor : staged) {
+        delete actor;
+    }
+    staged.clear();
+    // Textures uploaded for a scene that never became current
+    TextureCache::ReleaseScene(loading_scene);
+    Discard();
+}
+
+// Releases whatever the main thread did not take
+void AsyncScene::Discard() {
+    for(DecodedImage& image : images) {
+        if(image.surface != nullptr) {
+            SDL_FreeSurface(image.surface);
+        }
+    }
+    // Decoded clips are worth keeping even if the scene is not
+    for(DecodedClip& clip : clips) {
+        Audio::AddClip(clip.name, clip.chunk);
+    }
+    images.clear();
+    clips.clear();
+    template_docs.clear();
+    scene.reset();
+    next_template = 0;
+    next_image = 0;
+    next_clip = 0;
+    phase = Phase::Idle;
+}
+
+void AsyncScene::Shutdown() {
+    cancelled = true;
+    // The main thread can exit() mid-read; the worker never exits itself
+    if(worker.joinable()) {
+        worker.join();
+    }
+}
+
+bool AsyncScene::IsLoading() {
+    return phase != Phase::Idle;
+}
+
+float AsyncScene::GetProgress() {
+    if(phase == Phase::Idle) {
+        return 1.0f;
+    }
+    // The worker's decoding counts for the first half
+    if(phase == Phase::Reading) {
+        int total = assets_total.load();
+        return total > 0 ? 0.5f * assets_done.load() / total : 0.0f;
+    }
+    size_t total = template_docs.size() + images.size() + clips.size() + (*scene)["actors"].Size();
+    size_t done = next_template + next_image + next_clip + staged.size();
+    return total > 0 ? 0.5f + 0.5f * done / total : 1.0f;
+}
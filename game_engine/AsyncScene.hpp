@@ -0,0 +1,87 @@
+//
+//  AsyncScene.hpp
+//  game_engine
+//
+//  Created by Jasmine Li on 4/30/24.
+//
+
+#ifndef AsyncScene_hpp
+#define AsyncScene_hpp
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <unordered_set>
+#include "rapidjson/document.h"
+#include "SDL2/SDL.h"
+#include "SDL2_mixer/SDL_mixer.h"
+
+class Actor;
+
+// Scene.LoadAsync. A worker thread parses the scene and its templates and
+// decodes the images/audio its components name while the current scene keeps
+// running. Each frame the main thread then spends up to async_load_budget_ms
+// installing templates, uploading textures and building actors, and finally
+// swaps scenes the same way Scene.Load does.
+class AsyncScene {
+public:
+    static void Initialize();
+    static void Load(std::string scene_name);
+    static void Update();
+    static void Cancel();
+    static void Shutdown();
+
+    static bool IsLoading();
+    static float GetProgress();
+
+private:
+    enum class Phase { Idle, Reading, Installing, Staging };
+
+    struct DecodedImage {
+        std::string name;
+        SDL_Surface* surface;
+    };
+    struct DecodedClip {
+        std::string name;
+        Mix_Chunk* chunk;
+    };
+
+    static inline Phase phase = Phase::Idle;
+    static inline std::string loading_scene;
+    static inline float budget_ms = 4.0f;
+
+    static inline std::thread worker;
+    static inline std::atomic<bool> cancelled = false;
+    static inline std::atomic<bool> read_done = false;
+    static inline std::atomic<int> assets_total = 0;
+    static inline std::atomic<int> assets_done = 0;
+
+    // Filled by the worker, read by the main thread once read_done is set
+    static inline std::unique_ptr<rapidjson::Document> scene;
+    static inline std::vector<std::pair<std::string, std::unique_ptr<rapidjson::Document>>> template_docs;
+    static inline std::vector<DecodedImage> images;
+    static inline std::vector<DecodedClip> clips;
+    static inline std::string error;
+
+    // What was already loaded when the load started; the worker skips these
+    static inline std::unordered_set<std::string> known_templates;
+    static inline std::unordered_set<std::string> known_images;
+    static inline std::unordered_set<std::string> known_clips;
+
+    static inline size_t next_template = 0;
+    static inline size_t next_image = 0;
+    static inline size_t next_clip = 0;
+    static inline std::vector<Actor*> staged;
+
+    static void Read();
+    static void Fail(const std::string& message);
+    static void CollectAssets(rapidjson::Value& actor, std::unordered_set<std::string>& image_names, std::unordered_set<std::string>& clip_names);
+    static bool Step();
+    static void Switch();
+    static void Discard();
+};
+
+#endif /* AsyncScene_hpp */
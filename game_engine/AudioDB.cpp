@@ -6,30 +6,43 @@
 //
 
 #include "AudioDB.hpp"
+#include "AssetManifest.hpp"
 
 void Audio::Initialize() {
     AudioHelper::Mix_OpenAudio498(44100, AUDIO_S16SYS, 2, 2048);
     AudioHelper::Mix_AllocateChannels498(50);
 }
 
-void Audio::Play(int channel, std::string clip_name, bool loops) {
-    if(loaded_audio.find(clip_name) == loaded_audio.end()) {
-        std::filesystem::path wav = resources/"audio"/(clip_name +".wav");
-        std::filesystem::path ogg = resources/"audio"/(clip_name +".ogg");
-        if(std::filesystem::exists(wav)) {
-            loaded_audio[clip_name] = AudioHelper::Mix_LoadWAV498(wav.string().c_str());
-        } else if(std::filesystem::exists(ogg)) {
-            loaded_audio[clip_name] = AudioHelper::Mix_LoadWAV498(ogg.string().c_str());
-        } else {
-            std::cout << "error: failed to play audio clip " + clip_name;
-            exit(0);
-        }
+Mix_Chunk* Audio::Load(const std::string& clip_name) {
+    AssetManifest::Requested(AssetKind::Audio, clip_name);
+    auto loaded = loaded_audio.find(clip_name);
+    if(loaded != loaded_audio.end()) {
+        return loaded->second;
+    }
+    std::filesystem::path wav = resources/"audio"/(clip_name +".wav");
+    std::filesystem::path ogg = resources/"audio"/(clip_name +".ogg");
+    Mix_Chunk* chunk = nullptr;
+    if(std::filesystem::exists(wav)) {
+        chunk = AudioHelper::Mix_LoadWAV498(wav.string().c_str());
+    } else if(std::filesystem::exists(ogg)) {
+        chunk = AudioHelper::Mix_LoadWAV498(ogg.string().c_str());
+    } else {
+        Logger::Flush();
+        std::cout << "error: failed to play audio clip " + clip_name;
+        exit(0);
     }
+    AssetManifest::Loaded();
+    loaded_audio[clip_name] = chunk;
+    return chunk;
+}
+
+void Audio::Play(int channel, std::string clip_name, bool loops) {
+    Mix_Chunk* chunk = Load(clip_name);
     int l = 0;
     if(loops) {
         l = -1;
     }
-    AudioHelper::Mix_PlayChannel498(channel, loaded_audio[clip_name], l);
+    AudioHelper::Mix_PlayChannel498(channel, chunk, l);
 }
 
 void Audio::Halt(int channel) {
@@ -39,3 +52,24 @@ void Audio::Halt(int channel) {
 void Audio::SetVolume(int channel, int volume) {
     AudioHelper::Mix_Volume498(channel, volume);
 }
+
+std::vector<std::string> Audio::GetClipNames() {
+    std::vector<std::string> names;
+    for(auto& clip : loaded_audio) {
+        names.push_back(clip.first);
+    }
+    return names;
+}
+
+void Audio::AddClip(const std::string& clip_name, Mix_Chunk* chunk) {
+    if(chunk == nullptr) {
+        return;
+    }
+    auto clip = loaded_audio.find(clip_name);
+    if(clip == loaded_audio.end()) {
+        loaded_audio[clip_name] = chunk;
+    } else if(clip->second != chunk) {
+        // Loaded by Play while this copy was decoding
+        Mix_FreeChunk(chunk);
+    }
+}
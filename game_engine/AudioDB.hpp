@@ -18,9 +18,12 @@ private:
     static inline std::unordered_map<std::string, Mix_Chunk*> loaded_audio;
 public:
     static void Initialize();
+    static Mix_Chunk* Load(const std::string& clip_name);
     static void Play(int channel, std::string clip_name, bool loops);
     static void Halt(int channel);
     static void SetVolume(int channel, int volume);
+    static std::vector<std::string> GetClipNames();
+    static void AddClip(const std::string& clip_name, Mix_Chunk* chunk);
 };
 
 #endif /* AudioDB_hpp */
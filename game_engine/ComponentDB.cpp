@@ -16,9 +16,29 @@
 #include "Rigidbody.hpp"
 #include "Event.hpp"
 #include "Animation.hpp"
+#include "Region.hpp"
+#include "LuaGC.hpp"
+#include "ScriptCache.hpp"
+#include "Coroutines.hpp"
+#include "Logger.hpp"
+#include "ActorPool.hpp"
+#include "AsyncScene.hpp"
+#include "SceneStream.hpp"
+#include "TextureCache.hpp"
 
 lua_State* ComponentDB::lua_state = nullptr;
 
+void Component::RefreshSchedule() {
+    luabridge::LuaRef interval_lua = (*componentRef)["update_interval"];
+    int interval = interval_lua.isNumber() ? std::max(1, interval_lua.cast<int>()) : 1;
+    if(interval != update_interval) {
+        update_interval = interval;
+        update_phase = interval > 1 ? phase_counters[interval]++ % interval : 0;
+    }
+    luabridge::LuaRef priority_lua = (*componentRef)["update_priority"];
+    update_priority = priority_lua.isNumber() ? priority_lua.cast<int>() : 0;
+}
+
 lua_State* ComponentDB::GetLuaState() {
     return ComponentDB::lua_state;
 }
@@ -54,6 +74,11 @@ void ComponentDB::InitializeFunctions() {
         .addFunction("__add", &b2Vec2::operator_add)
         .addFunction("__sub", &b2Vec2::operator_sub)
         .addFunction("__mul", &b2Vec2::operator_mul)
+        .addFunction("Set", &b2Vec2::Set)
+        .addFunction("CopyFrom", &b2Vec2::CopyFrom)
+        .addFunction("AddInPlace", &b2Vec2::AddInPlace)
+        .addFunction("SubInPlace", &b2Vec2::SubInPlace)
+        .addFunction("MulInPlace", &b2Vec2::MulInPlace)
         .endClass()
         .beginNamespace("Vector2")
         .addFunction("Distance", b2Distance)
@@ -64,6 +89,10 @@ void ComponentDB::InitializeFunctions() {
         .beginNamespace("Debug")
         .addFunction("Log", ComponentDB::Print)
         .addFunction("LogError", ComponentDB::PrintErr)
+        .addFunction("LogWarning", ComponentDB::PrintWarning)
+        .addFunction("SetLogLevel", Logger::SetLevel)
+        .addFunction("GetLogLevel", Logger::GetLevel)
+        .addFunction("GetSuppressedCount", Logger::GetSuppressedCount)
         .endNamespace();
     // Application
     luabridge::getGlobalNamespace(lua_state)
@@ -72,19 +101,27 @@ void ComponentDB::InitializeFunctions() {
         .addFunction("Sleep", ComponentDB::Sleep)
         .addFunction("GetFrame", ComponentDB::GetFrame)
         .addFunction("OpenURL", ComponentDB::OpenURL)
+        .addFunction("SetScriptBudget", Actor::SetScriptBudget)
+        .addFunction("GetScriptBudget", Actor::GetScriptBudget)
+        .addFunction("GetDeferredCount", Actor::GetDeferredCount)
         .endNamespace();
     // Input
     luabridge::getGlobalNamespace(lua_state)
         .beginNamespace("Input")
-        .addFunction("GetKey", Input::GetKey)
-        .addFunction("GetKeyDown", Input::GetKeyDown)
-        .addFunction("GetKeyUp", Input::GetKeyUp)
+        .addFunction("GetKey", Input::GetKeyLua)
+        .addFunction("GetKeyDown", Input::GetKeyDownLua)
+        .addFunction("GetKeyUp", Input::GetKeyUpLua)
         .addFunction("GetMousePosition", Input::GetMousePosition)
+        .addFunction("GetMousePositionInto", Input::GetMousePositionInto)
+        .addFunction("GetMousePositionXY", Input::GetMousePositionXY)
         .addFunction("GetMouseButton", Input::GetMouseButton)
         .addFunction("GetMouseButtonDown", Input::GetMouseButtonDown)
         .addFunction("GetMouseButtonUp", Input::GetMouseButtonUp)
         .addFunction("GetMouseScrollDelta", Input::GetMouseScrollDelta)
         .endNamespace();
+    Input::RegisterKeyConstants(lua_state);
+    // Coroutines
+    Coroutines::Initialize(lua_state);
     // Actor
     luabridge::getGlobalNamespace(lua_state)
         .beginClass<Actor>("Actor")
@@ -102,6 +139,15 @@ void ComponentDB::InitializeFunctions() {
         .addFunction("Instantiate", &Actor::Instantiate)
         .addFunction("Destroy", &Actor::Destroy)
         .endNamespace();
+    // Pool
+    luabridge::getGlobalNamespace(lua_state)
+        .beginNamespace("Pool")
+        .addFunction("Prewarm", ActorPool::Prewarm)
+        .addFunction("GetAvailable", ActorPool::GetAvailable)
+        .addFunction("GetHits", ActorPool::GetHits)
+        .addFunction("GetMisses", ActorPool::GetMisses)
+        .addFunction("GetDropped", ActorPool::GetDropped)
+        .endNamespace();
     // Text
     luabridge::getGlobalNamespace(lua_state)
         .beginNamespace("Text")
@@ -122,6 +168,9 @@ void ComponentDB::InitializeFunctions() {
         .addFunction("Draw", Image::Draw)
         .addFunction("DrawEx", Image::DrawEx)
         .addFunction("DrawPixel", Image::DrawPixel)
+        .addFunction("GetCacheHitRate", TextureCache::GetHitRate)
+        .addFunction("GetResidentBytes", TextureCache::GetResidentBytes)
+        .addFunction("GetEvictions", TextureCache::GetEvictions)
         .endNamespace();
     // Camera
     luabridge::getGlobalNamespace(lua_state)
@@ -138,6 +187,13 @@ void ComponentDB::InitializeFunctions() {
         .addFunction("Load", Scene::Load)
         .addFunction("GetCurrent", Scene::GetCurrent)
         .addFunction("DontDestroy", Scene::DontDestroy)
+        .addFunction("Prefetch", Scene::Prefetch)
+        .addFunction("LoadAsync", AsyncScene::Load)
+        .addFunction("IsLoading", AsyncScene::IsLoading)
+        .addFunction("GetLoadProgress", AsyncScene::GetProgress)
+        .addFunction("Stream", SceneStream::Stream)
+        .addFunction("StopStream", SceneStream::Stop)
+        .addFunction("GetStreamedChunks", SceneStream::GetLoadedChunks)
         .endNamespace();
     // Rigidbody
     luabridge::getGlobalNamespace(lua_state)
@@ -180,6 +236,12 @@ void ComponentDB::InitializeFunctions() {
         .addFunction("SetUpDirection", &Rigidbody::SetUpDirection)
         .addFunction("SetRightDirection", &Rigidbody::SetRightDirection)
         .addFunction("GetVelocity", &Rigidbody::GetVelocity)
+        .addFunction("GetPositionInto", &Rigidbody::GetPositionInto)
+        .addFunction("GetVelocityInto", &Rigidbody::GetVelocityInto)
+        .addFunction("GetPositionXY", &Rigidbody::GetPositionXY)
+        .addFunction("GetVelocityXY", &Rigidbody::GetVelocityXY)
+        .addFunction("SetPositionXY", &Rigidbody::SetPositionXY)
+        .addFunction("SetVelocityXY", &Rigidbody::SetVelocityXY)
         .addFunction("GetAngularVelocity", &Rigidbody::GetAngularVelocity)
         .addFunction("GetGravityScale", &Rigidbody::GetGravityScale)
         .addFunction("GetUpDirection", &Rigidbody::GetUpDirection)
@@ -200,19 +262,50 @@ void ComponentDB::InitializeFunctions() {
         .addData("point", &HitResult::point)
         .addData("normal", &HitResult::normal)
         .addData("is_trigger", &HitResult::is_trigger)
+        .addData("fraction", &HitResult::fraction)
         .endClass();
     // Physics
     luabridge::getGlobalNamespace(lua_state)
         .beginNamespace("Physics")
         .addFunction("Raycast", Physics::Raycast)
         .addFunction("RaycastAll", Physics::RaycastAll)
+        .addFunction("CircleCast", Physics::CircleCast)
+        .addFunction("BoxCast", Physics::BoxCast)
+        .addFunction("Snapshot", Physics::Snapshot)
+        .addFunction("Restore", Physics::Restore)
+        .addFunction("DiscardSnapshot", Physics::DiscardSnapshot)
+        .addFunction("GetStackPeak", Physics::GetStackPeak)
+        .addFunction("GetStackCapacity", Physics::GetStackCapacity)
+        .addFunction("GetStackOverflows", Physics::GetStackOverflows)
+        .addFunction("ResetStackStats", Physics::ResetStackStats)
+        .endNamespace();
+    // Region
+    luabridge::getGlobalNamespace(lua_state)
+        .beginNamespace("Region")
+        .addFunction("SetRadius", Region::SetRadius)
+        .addFunction("GetRadius", Region::GetRadius)
+        .addFunction("SetCellSize", Region::SetCellSize)
+        .addFunction("GetActiveBodyCount", Region::GetActiveBodyCount)
+        .addFunction("GetInactiveBodyCount", Region::GetInactiveBodyCount)
+        .endNamespace();
+    // GC
+    luabridge::getGlobalNamespace(lua_state)
+        .beginNamespace("GC")
+        .addFunction("Collect", LuaGC::Collect)
+        .addFunction("SetBudget", LuaGC::SetBudget)
+        .addFunction("GetBudget", LuaGC::GetBudget)
+        .addFunction("GetHeapKB", LuaGC::GetHeapKB)
+        .addFunction("GetStepTime", LuaGC::GetStepTime)
+        .addFunction("GetStepCount", LuaGC::GetStepCount)
         .endNamespace();
     // Event
     luabridge::getGlobalNamespace(lua_state)
         .beginNamespace("Event")
-        .addFunction("Publish", EventManager::Publish)
-        .addFunction("Subscribe", EventManager::Subscribe)
-        .addFunction("Unsubscribe", EventManager::Unsubscribe)
+        .addFunction("Channel", EventManager::Channel)
+        .addFunction("Publish", EventManager::PublishLua)
+        .addFunction("Queue", EventManager::QueueLua)
+        .addFunction("Subscribe", EventManager::SubscribeLua)
+        .addFunction("Unsubscribe", EventManager::UnsubscribeLua)
         .endNamespace();
     // Animation
     luabridge::getGlobalNamespace(lua_state)
@@ -240,38 +333,93 @@ void ComponentDB::InitializeComponents() {
     // Check for component types directory
     std::filesystem::path component_types = std::filesystem::current_path() / "resources/component_types/";
     if (std::filesystem::exists(component_types)) {
-        // Add all components in directory to table
+        ScriptCache::Load();
+        // Register types only; scripts run the first time a type is used
         for(const auto& entry : std::filesystem::directory_iterator(component_types)) {
             if(entry.is_regular_file() && entry.path().extension() == ".lua") {
-                InitializeComponent(entry);
+                component_paths[entry.path().stem().string()] = "resources/component_types/" + entry.path().filename().string();
             }
         }
+        // Scripts that reference another type's global at load time pull it in
+        lua_pushglobaltable(lua_state);
+        lua_newtable(lua_state);
+        lua_pushcfunction(lua_state, LoadComponentGlobal);
+        lua_setfield(lua_state, -2, "__index");
+        lua_setmetatable(lua_state, -2);
+        lua_pop(lua_state, 1);
     }
 }
 
+// __index on the globals table: (globals, key)
+int ComponentDB::LoadComponentGlobal(lua_State* state) {
+    if(lua_type(state, 2) != LUA_TSTRING) {
+        return 0;
+    }
+    std::string type = lua_tostring(state, 2);
+    if(!HasComponentType(type) || component_tables.find(type) != component_tables.end() || loading_components.count(type)) {
+        return 0;
+    }
+    GetComponentTable(type);
+    lua_rawget(state, 1);
+    return 1;
+}
+
 // From discussion 6
-void ComponentDB::InitializeComponent(std::filesystem::directory_entry entry) {
-    std::string component_name = entry.path().stem().string();
-    if(luaL_dofile(lua_state, ("resources/component_types/" + entry.path().stem().string() + ".lua").c_str()) != LUA_OK) {
+void ComponentDB::InitializeComponent(const std::string& component_name) {
+    loading_components.insert(component_name);
+    if(ScriptCache::LoadFile(lua_state, component_paths[component_name]) != LUA_OK) {
+        Logger::Flush();
         std::cout << "problem with lua file " << component_name;
         exit(0);
     }
+    loading_components.erase(component_name);
+    // Raw lookup so a script that defines no global can't re-enter the loader
+    lua_pushglobaltable(lua_state);
+    lua_pushstring(lua_state, component_name.c_str());
+    lua_rawget(lua_state, -2);
     component_tables.insert({component_name,
-        std::make_shared<luabridge::LuaRef>(
-                        luabridge::getGlobal(lua_state, component_name.c_str()))
+        std::make_shared<luabridge::LuaRef>(luabridge::LuaRef::fromStack(lua_state, -1))
     });
+    // Instances inherit self:StartCoroutine/StopCoroutine from the type table
+    if(lua_istable(lua_state, -1)) {
+        lua_pushcfunction(lua_state, Coroutines::StartCoroutine);
+        lua_setfield(lua_state, -2, "StartCoroutine");
+        lua_pushcfunction(lua_state, Coroutines::StopCoroutine);
+        lua_setfield(lua_state, -2, "StopCoroutine");
+    }
+    lua_pop(lua_state, 2);
     component_counters.insert({component_name, 0});
 }
 
+bool ComponentDB::HasComponentType(const std::string& type) {
+    return component_paths.find(type) != component_paths.end();
+}
+
+std::shared_ptr<luabridge::LuaRef> ComponentDB::GetComponentTable(const std::string& type) {
+    auto it = component_tables.find(type);
+    if(it != component_tables.end()) {
+        return it->second;
+    }
+    if(!HasComponentType(type)) {
+        Logger::Flush();
+        std::cout << "error: failed to locate component " << type;
+        exit(0);
+    }
+    InitializeComponent(type);
+    return component_tables[type];
+}
+
 // From lecture 13
-void ComponentDB::EstablishInheritance(luabridge::LuaRef &instance_table, luabridge::LuaRef &parent_table) {
-    luabridge::LuaRef new_metatable = luabridge::newTable(lua_state);
-    new_metatable["__index"] = parent_table;
-    
-    instance_table.push(lua_state);
-    new_metatable.push(lua_state);
-    lua_setmetatable(lua_state, -2);
-    lua_pop(lua_state, 1);
+std::shared_ptr<luabridge::LuaRef> ComponentDB::GetComponentMetatable(const std::string& type) {
+    auto it = component_metatables.find(type);
+    if(it != component_metatables.end()) {
+        return it->second;
+    }
+    // One metatable per type, shared by every instance
+    std::shared_ptr<luabridge::LuaRef> metatable = std::make_shared<luabridge::LuaRef>(luabridge::newTable(lua_state));
+    (*metatable)["__index"] = *GetComponentTable(type);
+    component_metatables[type] = metatable;
+    return metatable;
 }
 
 std::shared_ptr<luabridge::LuaRef> ComponentDB::CreateRigidbody(std::string name) {
@@ -302,14 +450,48 @@ std::shared_ptr<luabridge::LuaRef> ComponentDB::CreateAnimation(std::string name
 
 std::shared_ptr<luabridge::LuaRef> ComponentDB::CreateComponentInstance(std::string name, std::string type) {
     // Create instance of component
-    std::shared_ptr<luabridge::LuaRef> component_instance = std::make_shared<luabridge::LuaRef>(luabridge::newTable(ComponentDB::lua_state));
-    ComponentDB::EstablishInheritance(*component_instance, *ComponentDB::component_tables[type]);
+    lua_createtable(lua_state, 0, 4);
+    GetComponentMetatable(type)->push(lua_state);
+    lua_setmetatable(lua_state, -2);
+    std::shared_ptr<luabridge::LuaRef> component_instance = std::make_shared<luabridge::LuaRef>(luabridge::LuaRef::fromStack(lua_state, -1));
+    lua_pop(lua_state, 1);
     (*component_instance)["key"] = name;
     (*component_instance)["type"] = type;
     (*component_instance)["enabled"] = true;
     return component_instance;
 }
 
+// Raw copy of every field of the table at source into the table at copy
+static void CopyFields(lua_State* lua_state, int source, int copy) {
+    lua_pushnil(lua_state);
+    while(lua_next(lua_state, source) != 0) {
+        lua_pushvalue(lua_state, -2);
+        lua_insert(lua_state, -2);
+        lua_rawset(lua_state, copy);
+    }
+}
+
+std::shared_ptr<luabridge::LuaRef> ComponentDB::CloneComponentInstance(const luabridge::LuaRef& prototype, const std::string& type, int field_count) {
+    // Raw copy of the prototype's fields into a table sized for them
+    prototype.push(lua_state);
+    int source = lua_gettop(lua_state);
+    lua_createtable(lua_state, 0, field_count);
+    int copy = lua_gettop(lua_state);
+    CopyFields(lua_state, source, copy);
+    GetComponentMetatable(type)->push(lua_state);
+    lua_setmetatable(lua_state, copy);
+    std::shared_ptr<luabridge::LuaRef> component_instance = std::make_shared<luabridge::LuaRef>(luabridge::LuaRef::fromStack(lua_state, copy));
+    lua_pop(lua_state, 2);
+    return component_instance;
+}
+
+void ComponentDB::ResetComponentInstance(const luabridge::LuaRef& prototype, luabridge::LuaRef& component_instance) {
+    prototype.push(lua_state);
+    component_instance.push(lua_state);
+    CopyFields(lua_state, lua_gettop(lua_state) - 1, lua_gettop(lua_state));
+    lua_pop(lua_state, 2);
+}
+
 std::shared_ptr<luabridge::LuaRef> ComponentDB::OverrideComponentInstance(std::shared_ptr<luabridge::LuaRef> component_instance, rapidjson::Value& val) {
     // Override values
     for (auto& pair : val.GetObject()) {
@@ -336,10 +518,16 @@ std::shared_ptr<luabridge::LuaRef> ComponentDB::OverrideComponentInstance(std::s
 }
 
 void ComponentDB::Print(std::string message) {
-    std::cout << message << std::endl;
+    Logger::Write(LogLevel::Info, message);
+}
+
+void ComponentDB::PrintWarning(std::string message) {
+    Logger::Write(LogLevel::Warning, message);
 }
 void ComponentDB::PrintErr(std::string message) {
-    std::cerr << message << std::endl;
+    // Errors often come right before a crash or Application.Quit, so don't leave them queued
+    Logger::Write(LogLevel::Error, message, LogStyle::Err);
+    Logger::Flush();
 }
 
 void ComponentDB::Quit() {
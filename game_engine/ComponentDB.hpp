@@ -10,6 +10,7 @@
 
 #include <stdio.h>
 #include <filesystem>
+#include <unordered_set>
 #include "rapidjson/document.h"
 #include "lua.hpp"
 #include "LuaBridge.h"
@@ -23,38 +24,65 @@ public:
     
     bool enabled;
     
+    // Update scheduling: tick every update_interval frames, offset by update_phase.
+    // Components with update_priority < 0 may be deferred when over the script budget.
+    int update_interval = 1;
+    int update_phase = 0;
+    int update_priority = 0;
+    bool deferred = false;
+    bool ticking = true;
+    
     explicit Component() {}
     
     explicit Component(std::string key, std::string type, std::shared_ptr<luabridge::LuaRef> componentRef) : key(key), type(type), componentRef(componentRef) {
         enabled = (*componentRef)["enabled"];
+        RefreshSchedule();
+    }
+    
+    void RefreshSchedule();
+    bool Due(int frame) const {
+        return deferred || update_interval <= 1 || (frame + update_phase) % update_interval == 0;
     }
+    
+private:
+    // Next phase handed out per interval, so same-interval components spread evenly
+    static inline std::unordered_map<int, int> phase_counters;
 };
 
 class ComponentDB {
 private:
     static lua_State *lua_state;
+    static inline std::unordered_set<std::string> loading_components;
     
     static void Print(std::string message);
     static void PrintErr(std::string message);
+    static void PrintWarning(std::string message);
     
     static void Quit();
     static void Sleep(int milliseconds);
     static int GetFrame();
     static void OpenURL(std::string url);
+    static int LoadComponentGlobal(lua_State* state);
 public:
     static inline std::unordered_map<std::string, std::shared_ptr<luabridge::LuaRef>> component_tables;
+    static inline std::unordered_map<std::string, std::shared_ptr<luabridge::LuaRef>> component_metatables;
     static inline std::unordered_map<std::string, int> component_counters;
+    static inline std::unordered_map<std::string, std::filesystem::path> component_paths;
     
     static lua_State* GetLuaState();
     static void Initialize();
     static void InitializeState();
     static void InitializeFunctions();
     static void InitializeComponents();
-    static void InitializeComponent(std::filesystem::directory_entry entry);
-    static void EstablishInheritance(luabridge::LuaRef &instance_table, luabridge::LuaRef &parent_table);
+    static void InitializeComponent(const std::string& component_name);
+    static bool HasComponentType(const std::string& type);
+    static std::shared_ptr<luabridge::LuaRef> GetComponentTable(const std::string& type);
+    static std::shared_ptr<luabridge::LuaRef> GetComponentMetatable(const std::string& type);
     static std::shared_ptr<luabridge::LuaRef> CreateRigidbody(std::string name);
     static std::shared_ptr<luabridge::LuaRef> CreateAnimation(std::string name);
     static std::shared_ptr<luabridge::LuaRef> CreateComponentInstance(std::string name, std::string type);
+    static std::shared_ptr<luabridge::LuaRef> CloneComponentInstance(const luabridge::LuaRef& prototype, const std::string& type, int field_count);
+    static void ResetComponentInstance(const luabridge::LuaRef& prototype, luabridge::LuaRef& component_instance);
     static std::shared_ptr<luabridge::LuaRef> OverrideComponentInstance(std::shared_ptr<luabridge::LuaRef> component_instance, rapidjson::Value& val);
 };
 
@@ -0,0 +1,309 @@
+//
+//  Coroutines.cpp
+//  game_engine
+//
+//  Created by Jasmine Li on 4/26/24.
+//
+
+#include <cmath>
+#include <algorithm>
+#include "SDL2/SDL.h"
+#include "Coroutines.hpp"
+#include "Actor.hpp"
+#include "Event.hpp"
+#include "ComponentDB.hpp"
+#include "Logger.hpp"
+
+void TimerWheel::Add(int id, int64_t target) {
+    target = std::max(target, current + 1);
+    buckets[target % num_buckets].push_back({id, target});
+}
+
+void TimerWheel::Advance(int64_t now, std::vector<int>& ready) {
+    // A long stall visits each bucket at most once
+    int64_t steps = std::min<int64_t>(now - current, num_buckets);
+    for(int64_t i = 1; i <= steps; ++i) {
+        std::vector<std::pair<int, int64_t>>& bucket = buckets[(current + i) % num_buckets];
+        for(size_t j = 0; j < bucket.size();) {
+            if(bucket[j].second <= now) {
+                ready.push_back(bucket[j].first);
+                bucket[j] = bucket.back();
+                bucket.pop_back();
+            } else {
+                ++j;
+            }
+        }
+    }
+    current = std::max(current, now);
+}
+
+int64_t Coroutines::NowTick() {
+    return SDL_GetTicks() / seconds_tick_ms;
+}
+
+void Coroutines::Initialize(lua_State* lua_state) {
+    time_wheel.SetCurrent(NowTick());
+    luabridge::getGlobalNamespace(lua_state)
+        .addFunction("WaitFrames", Coroutines::WaitFrames)
+        .addFunction("WaitSeconds", Coroutines::WaitSeconds)
+        .addFunction("WaitUntilEvent", Coroutines::WaitUntilEvent)
+        .addFunction("WaitForPhysics", Coroutines::WaitForPhysics);
+}
+
+int Coroutines::StartCoroutine(lua_State* lua_state) {
+    luaL_checktype(lua_state, 1, LUA_TTABLE);
+    luaL_checktype(lua_state, 2, LUA_TFUNCTION);
+    int nargs = lua_gettop(lua_state) - 2;
+
+    Routine routine;
+    luabridge::LuaRef self = luabridge::LuaRef::fromStack(lua_state, 1);
+    luabridge::LuaRef actor_ref = self["actor"];
+    luabridge::LuaRef key_ref = self["key"];
+    routine.actor = actor_ref.isNil() ? nullptr : actor_ref.cast<Actor*>();
+    routine.key = key_ref.isString() ? key_ref.cast<std::string>() : "";
+
+    // Anchor the thread, then move fn, self and any extra args onto it
+    routine.thread = lua_newthread(lua_state);
+    routine.thread_ref = luaL_ref(lua_state, LUA_REGISTRYINDEX);
+    lua_pushvalue(lua_state, 2);
+    lua_pushvalue(lua_state, 1);
+    for(int i = 0; i < nargs; ++i) {
+        lua_pushvalue(lua_state, 3 + i);
+    }
+    lua_xmove(lua_state, routine.thread, nargs + 2);
+
+    int id = next_id++;
+    routines[id] = routine;
+    owned[routine.actor].push_back(id);
+    by_thread[routine.thread] = id;
+
+    // Runs until its first wait, like Unity
+    Resume(id);
+    lua_pushinteger(lua_state, id);
+    return 1;
+}
+
+int Coroutines::StopCoroutine(lua_State* lua_state) {
+    if(lua_isinteger(lua_state, 2)) {
+        Cancel(static_cast<int>(lua_tointeger(lua_state, 2)));
+    }
+    return 0;
+}
+
+void Coroutines::Resume(int id) {
+    auto it = routines.find(id);
+    if(it == routines.end()) {
+        return;
+    }
+    Routine& routine = it->second;
+    lua_State* thread = routine.thread;
+
+    int nargs = 0;
+    if(lua_status(thread) == LUA_OK && lua_gettop(thread) > 0) {
+        nargs = lua_gettop(thread) - 1; // first run: fn, self, args
+    }
+    if(routine.value_ref != LUA_NOREF) {
+        lua_rawgeti(thread, LUA_REGISTRYINDEX, routine.value_ref);
+        luaL_unref(thread, LUA_REGISTRYINDEX, routine.value_ref);
+        routine.value_ref = LUA_NOREF;
+        nargs = 1;
+    }
+
+    routine.wait = WAIT_NONE;
+    routine.wait_amount = 0;
+    routine.running = true;
+    int nresults = 0;
+    int status = lua_resume(thread, ComponentDB::GetLuaState(), nargs, &nresults);
+
+    // The map may have grown during the resume
+    Routine& after = routines[id];
+    WaitKind wait = after.wait;
+    int64_t amount = after.wait_amount;
+    after.running = false;
+    if(after.cancelled || status == LUA_OK) {
+        Finish(id);
+        return;
+    }
+    if(status != LUA_YIELD) {
+        std::string err_msg = lua_tostring(thread, -1) ? lua_tostring(thread, -1) : "error in coroutine";
+        std::replace(err_msg.begin(), err_msg.end(), '\\', '/');
+        Logger::Write(LogLevel::Error, (after.actor ? after.actor->actor_name : "") + " : " + err_msg, LogStyle::Highlight);
+        Finish(id);
+        return;
+    }
+    lua_pop(thread, nresults);
+
+    switch(wait) {
+        case WAIT_SECONDS:
+            time_wheel.Add(id, amount);
+            break;
+        case WAIT_EVENT:
+            EventManager::AddWaiter(static_cast<int>(amount), id);
+            break;
+        case WAIT_PHYSICS:
+            physics_waiters.push_back(id);
+            break;
+        case WAIT_FRAMES:
+            frame_wheel.Add(id, frame + std::max<int64_t>(amount, 1));
+            break;
+        default:
+            // A bare coroutine.yield() waits one frame
+            frame_wheel.Add(id, frame + 1);
+            break;
+    }
+}
+
+void Coroutines::Finish(int id) {
+    auto it = routines.find(id);
+    if(it == routines.end()) {
+        return;
+    }
+    lua_State* lua_state = ComponentDB::GetLuaState();
+    if(it->second.wait == WAIT_EVENT) {
+        EventManager::RemoveWaiter(static_cast<int>(it->second.wait_amount), id);
+    }
+    by_thread.erase(it->second.thread);
+    luaL_unref(lua_state, LUA_REGISTRYINDEX, it->second.thread_ref);
+    if(it->second.value_ref != LUA_NOREF) {
+        luaL_unref(lua_state, LUA_REGISTRYINDEX, it->second.value_ref);
+    }
+    auto owner = owned.find(it->second.actor);
+    if(owner != owned.end()) {
+        std::vector<int>& ids = owner->second;
+        ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+        if(ids.empty()) {
+            owned.erase(owner);
+        }
+    }
+    // Stale ids left in the wheels are skipped on wake
+    routines.erase(it);
+}
+
+void Coroutines::Cancel(int id) {
+    auto it = routines.find(id);
+    if(it == routines.end()) {
+        return;
+    }
+    if(it->second.running) {
+        it->second.cancelled = true; // finished when its resume returns
+    } else {
+        Finish(id);
+    }
+}
+
+void Coroutines::CancelAll(Actor* actor) {
+    auto owner = owned.find(actor);
+    if(owner == owned.end()) {
+        return;
+    }
+    std::vector<int> ids = owner->second;
+    for(int id : ids) {
+        Cancel(id);
+    }
+}
+
+void Coroutines::CancelAll(Actor* actor, const std::string& key) {
+    auto owner = owned.find(actor);
+    if(owner == owned.end()) {
+        return;
+    }
+    std::vector<int> ids = owner->second;
+    for(int id : ids) {
+        if(routines[id].key == key) {
+            Cancel(id);
+        }
+    }
+}
+
+void Coroutines::Update() {
+    ++frame;
+    std::vector<int> ready;
+    ready.swap(woken);
+    frame_wheel.Advance(frame, ready);
+    time_wheel.Advance(NowTick(), ready);
+    for(int id : ready) {
+        Resume(id);
+    }
+}
+
+void Coroutines::AfterPhysics() {
+    std::vector<int> ready;
+    ready.swap(physics_waiters);
+    for(int id : ready) {
+        Resume(id);
+    }
+}
+
+void Coroutines::WakeFromEvent(int id, const luabridge::LuaRef& event_object) {
+    auto it = routines.find(id);
+    if(it == routines.end() || it->second.value_ref != LUA_NOREF) {
+        return;
+    }
+    // Resumed at the next Update with the event object as WaitUntilEvent's result
+    event_object.push(event_object.state());
+    it->second.value_ref = luaL_ref(event_object.state(), LUA_REGISTRYINDEX);
+    woken.push_back(id);
+}
+
+// Null for plain Lua coroutines; a Wait* there just yields to whoever resumed it
+Coroutines::Routine* Coroutines::RoutineOf(lua_State* thread) {
+    auto id = by_thread.find(thread);
+    if(id == by_thread.end()) {
+        return nullptr;
+    }
+    auto it = routines.find(id->second);
+    return it == routines.end() ? nullptr : &it->second;
+}
+
+int Coroutines::GetRunningCount() {
+    return static_cast<int>(routines.size());
+}
+
+int Coroutines::WaitFrames(lua_State* lua_state) {
+    if(!lua_isyieldable(lua_state)) {
+        return luaL_error(lua_state, "WaitFrames must be called from a coroutine");
+    }
+    int64_t frames = luaL_optinteger(lua_state, 1, 1);
+    if(Routine* routine = RoutineOf(lua_state)) {
+        routine->wait = WAIT_FRAMES;
+        routine->wait_amount = frames;
+    }
+    return lua_yield(lua_state, 0);
+}
+
+int Coroutines::WaitSeconds(lua_State* lua_state) {
+    if(!lua_isyieldable(lua_state)) {
+        return luaL_error(lua_state, "WaitSeconds must be called from a coroutine");
+    }
+    double seconds = luaL_checknumber(lua_state, 1);
+    if(Routine* routine = RoutineOf(lua_state)) {
+        routine->wait = WAIT_SECONDS;
+        routine->wait_amount = static_cast<int64_t>(std::ceil((SDL_GetTicks() + seconds * 1000.0) / seconds_tick_ms));
+    }
+    return lua_yield(lua_state, 0);
+}
+
+int Coroutines::WaitUntilEvent(lua_State* lua_state) {
+    if(!lua_isyieldable(lua_state)) {
+        return luaL_error(lua_state, "WaitUntilEvent must be called from a coroutine");
+    }
+    int channel = EventManager::ChannelOf(lua_state, 1, true);
+    if(channel < 0) {
+        return luaL_error(lua_state, "WaitUntilEvent needs an event name or channel");
+    }
+    if(Routine* routine = RoutineOf(lua_state)) {
+        routine->wait = WAIT_EVENT;
+        routine->wait_amount = channel;
+    }
+    return lua_yield(lua_state, 0);
+}
+
+int Coroutines::WaitForPhysics(lua_State* lua_state) {
+    if(!lua_isyieldable(lua_state)) {
+        return luaL_error(lua_state, "WaitForPhysics must be called from a coroutine");
+    }
+    if(Routine* routine = RoutineOf(lua_state)) {
+        routine->wait = WAIT_PHYSICS;
+    }
+    return lua_yield(lua_state, 0);
+}
@@ -0,0 +1,97 @@
+//
+//  Coroutines.hpp
+//  game_engine
+//
+//  Created by Jasmine Li on 4/26/24.
+//
+
+#ifndef Coroutines_hpp
+#define Coroutines_hpp
+
+#include <stdio.h>
+#include <string>
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include "lua.hpp"
+#include "LuaBridge.h"
+
+class Actor;
+
+// Hashed timer wheel; entries past one revolution stay in their bucket
+// until their tick comes round
+class TimerWheel {
+public:
+    static const int num_buckets = 256;
+
+    void Add(int id, int64_t target);
+    void Advance(int64_t now, std::vector<int>& ready);
+    int64_t GetCurrent() const { return current; }
+    void SetCurrent(int64_t now) { current = now; }
+
+private:
+    std::array<std::vector<std::pair<int, int64_t>>, num_buckets> buckets;
+    int64_t current = 0;
+};
+
+// Engine-driven Lua coroutines. Components start them with
+// self:StartCoroutine(fn, ...) and suspend with WaitFrames, WaitSeconds,
+// WaitUntilEvent or WaitForPhysics. Sleeping coroutines sit in timer
+// wheels or waiter lists and are not touched until due.
+class Coroutines {
+public:
+    static const int seconds_tick_ms = 10;
+
+    static void Initialize(lua_State* lua_state);
+    static void Update();
+    static void AfterPhysics();
+    static void WakeFromEvent(int id, const luabridge::LuaRef& event_object);
+
+    static void Cancel(int id);
+    static void CancelAll(Actor* actor);
+    static void CancelAll(Actor* actor, const std::string& key);
+
+    static int GetRunningCount();
+
+    // Lua entry points
+    static int StartCoroutine(lua_State* lua_state);
+    static int StopCoroutine(lua_State* lua_state);
+    static int WaitFrames(lua_State* lua_state);
+    static int WaitSeconds(lua_State* lua_state);
+    static int WaitUntilEvent(lua_State* lua_state);
+    static int WaitForPhysics(lua_State* lua_state);
+
+private:
+    enum WaitKind { WAIT_NONE, WAIT_FRAMES, WAIT_SECONDS, WAIT_EVENT, WAIT_PHYSICS };
+
+    struct Routine {
+        lua_State* thread = nullptr;
+        int thread_ref = LUA_NOREF;
+        int value_ref = LUA_NOREF;
+        Actor* actor = nullptr;
+        std::string key;
+        bool running = false;
+        bool cancelled = false;
+        // Set by a Wait* call on this routine's own thread just before it yields
+        WaitKind wait = WAIT_NONE;
+        int64_t wait_amount = 0;
+    };
+
+    static inline std::unordered_map<int, Routine> routines;
+    static inline std::unordered_map<Actor*, std::vector<int>> owned;
+    static inline std::unordered_map<lua_State*, int> by_thread;
+    static inline int next_id = 1;
+
+    static inline TimerWheel frame_wheel;
+    static inline TimerWheel time_wheel;
+    static inline int64_t frame = 0;
+    static inline std::vector<int> physics_waiters;
+    static inline std::vector<int> woken;
+
+    static Routine* RoutineOf(lua_State* thread);
+    static void Resume(int id);
+    static void Finish(int id);
+    static int64_t NowTick();
+};
+
+#endif /* Coroutines_hpp */
@@ -9,15 +9,62 @@
 #define EngineUtils_h
 
 #include <iostream>
+#include <cstdlib>
+#include <filesystem>
 #include "SDL2/SDL.h"
 #include "rapidjson/filereadstream.h"
 #include "rapidjson/document.h"
+#include "Logger.hpp"
 
 class EngineUtils {
 public:
 
-    /* Code provided from EECS 498.007 staff */
+    // Reads the whole file into the document's own allocator and parses it in
+    // place, so strings point into that buffer instead of being copied. The
+    // buffer lives exactly as long as the document.
     static void ReadJsonFile(const std::string& path, rapidjson::Document & out_document)
+    {
+        if (!ParseJsonFile(path, out_document)) {
+            Logger::Flush();
+            std::cout << JsonError(path, out_document) << std::endl;
+            exit(0);
+        }
+    }
+
+    // Same, but false on a parse error instead of exiting; worker threads must not exit()
+    static bool ParseJsonFile(const std::string& path, rapidjson::Document & out_document)
+    {
+        FILE* file_pointer = nullptr;
+    #ifdef _WIN32
+        fopen_s(&file_pointer, path.c_str(), "rb");
+    #else
+        file_pointer = fopen(path.c_str(), "rb");
+    #endif
+        size_t size = 0;
+        if (file_pointer != nullptr && std::fseek(file_pointer, 0, SEEK_END) == 0) {
+            long end = std::ftell(file_pointer);
+            size = end > 0 ? static_cast<size_t>(end) : 0;
+            std::fseek(file_pointer, 0, SEEK_SET);
+        }
+        char* buffer = static_cast<char*>(out_document.GetAllocator().Malloc(size + 1));
+        size_t read = file_pointer != nullptr ? std::fread(buffer, 1, size, file_pointer) : 0;
+        buffer[read] = '\0';
+        if (file_pointer != nullptr) {
+            std::fclose(file_pointer);
+        }
+        out_document.ParseInsitu(buffer);
+        return !out_document.HasParseError();
+    }
+
+    static std::string JsonError(const std::string& path, const rapidjson::Document & document)
+    {
+        return std::to_string(document.GetParseError()) + "error parsing json at [" + path + "]";
+    }
+
+    /* Code provided from EECS 498.007 staff */
+    // Chunked read for large, number-heavy files (Spriter .scon) where keeping
+    // the whole text alive would cost more memory than the string copies save.
+    static void StreamJsonFile(const std::string& path, rapidjson::Document & out_document)
     {
         FILE* file_pointer = nullptr;
     #ifdef _WIN32
@@ -32,11 +79,27 @@ public:
 
         if (out_document.HasParseError()) {
             rapidjson::ParseErrorCode errorCode = out_document.GetParseError();
+            Logger::Flush();
             std::cout << errorCode << "error parsing json at [" << path << "]" << std::endl;
             exit(0);
         }
     }
 
+    // Shared pool for ScratchJsonDocument. The first block is static, so a
+    // Clear() keeps it for the next load and small files never hit malloc.
+    static rapidjson::MemoryPoolAllocator<>& JsonScratch()
+    {
+        alignas(8) static char first_block[256 * 1024];
+        static rapidjson::MemoryPoolAllocator<> allocator(first_block, sizeof(first_block));
+        return allocator;
+    }
+
+    static int& JsonScratchDepth()
+    {
+        static int depth = 0;
+        return depth;
+    }
+
     /* Code provided from EECS 498.007 staff */
     static std::string obtain_word_after_phrase(const std::string& input, const std::string& phrase) {
         size_t pos = input.find(phrase);
@@ -86,7 +149,53 @@ public:
         }
         return static_cast<SDL_RendererFlip>(flip);
     }
+    
+    // Empty string if unset
+    static std::string GetEnvVariable(const char* name)
+    {
+    #ifdef _WIN32
+        char* val = nullptr;
+        size_t length = 0;
+        _dupenv_s(&val, &length, name);
+        std::string result = val ? val : "";
+        free(val);
+        return result;
+    #else
+        const char* val = std::getenv(name);
+        return val ? val : "";
+    #endif
+    }
+    
+    // Size and mtime used to tell whether a cached artifact is stale
+    static bool GetFileStamp(const std::filesystem::path& path, uint64_t& size, int64_t& mtime)
+    {
+        std::error_code ec;
+        size = std::filesystem::file_size(path, ec);
+        if(ec) {
+            return false;
+        }
+        mtime = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+        return !ec;
+    }
+
+};
 
+// A document for JSON that is read and dropped within one call (configs,
+// prefetch/compile passes). All of them allocate from EngineUtils::JsonScratch,
+// which is reset when the outermost one goes away. Main thread only.
+class ScratchJsonDocument : public rapidjson::Document {
+public:
+    ScratchJsonDocument() : rapidjson::Document(&EngineUtils::JsonScratch())
+    {
+        ++EngineUtils::JsonScratchDepth();
+    }
+
+    ~ScratchJsonDocument()
+    {
+        if (--EngineUtils::JsonScratchDepth() == 0) {
+            EngineUtils::JsonScratch().Clear();
+        }
+    }
 };
 
 #endif /* EngineUtils_h */
@@ -5,45 +5,226 @@
 //  Created by Jasmine Li on 4/1/24.
 //
 
+#include <algorithm>
 #include "Event.hpp"
+#include "ComponentDB.hpp"
+#include "Coroutines.hpp"
+
+// Handle layout: channel (16 bits) | generation (24 bits) | slot (24 bits)
+static int64_t MakeHandle(int channel, uint32_t generation, int slot) {
+    return (static_cast<int64_t>(channel) << 48) | (static_cast<int64_t>(generation & 0xFFFFFF) << 24) | slot;
+}
+
+int EventManager::Intern(lua_State* lua_state, const std::string& event_type) {
+    auto it = channel_ids.find(event_type);
+    if(it != channel_ids.end()) {
+        return it->second;
+    }
+    int id = static_cast<int>(channels.size());
+    channels.push_back({{}, {}, 0, {}, false, luabridge::LuaRef(lua_state)});
+    channel_ids[event_type] = id;
+    return id;
+}
+
+int EventManager::Find(const std::string& event_type) {
+    auto it = channel_ids.find(event_type);
+    return it == channel_ids.end() ? -1 : it->second;
+}
+
+int EventManager::ChannelOf(lua_State* lua_state, int index, bool create) {
+    if(lua_isinteger(lua_state, index)) {
+        lua_Integer id = lua_tointeger(lua_state, index);
+        return id >= 0 && id < static_cast<lua_Integer>(channels.size()) ? static_cast<int>(id) : -1;
+    }
+    if(lua_type(lua_state, index) == LUA_TSTRING) {
+        std::string event_type = lua_tostring(lua_state, index);
+        return create ? Intern(lua_state, event_type) : Find(event_type);
+    }
+    return -1;
+}
+
+bool EventManager::HasListeners(int channel) {
+    return channels[channel].active > 0 || !channels[channel].waiters.empty();
+}
+
+int EventManager::Channel(std::string event_type) {
+    return Intern(ComponentDB::GetLuaState(), event_type);
+}
+
+EventManager::Slot* EventManager::SlotOf(int64_t handle) {
+    int channel = static_cast<int>(handle >> 48);
+    int slot = static_cast<int>(handle & 0xFFFFFF);
+    uint32_t generation = static_cast<uint32_t>((handle >> 24) & 0xFFFFFF);
+    if(channel < 0 || channel >= static_cast<int>(channels.size()) || slot >= static_cast<int>(channels[channel].slots.size())) {
+        return nullptr;
+    }
+    Slot& s = channels[channel].slots[slot];
+    if(s.state == SLOT_FREE || (s.generation & 0xFFFFFF) != generation) {
+        return nullptr;
+    }
+    return &s;
+}
+
+void EventManager::Deliver(int channel, const luabridge::LuaRef& event_object) {
+    EventChannel& ch = channels[channel];
+    // Slots added during delivery are pending and skipped
+    size_t count = ch.slots.size();
+    for(size_t i = 0; i < count; ++i) {
+        Slot& s = ch.slots[i];
+        if(s.state == SLOT_ACTIVE && !s.component.isNil() && !s.function.isNil()) {
+            s.function(s.component, event_object);
+        }
+    }
+    if(!channels[channel].waiters.empty()) {
+        std::vector<int> waking;
+        waking.swap(channels[channel].waiters);
+        for(int id : waking) {
+            Coroutines::WakeFromEvent(id, event_object);
+        }
+    }
+}
+
+void EventManager::AddWaiter(int channel, int routine_id) {
+    channels[channel].waiters.push_back(routine_id);
+}
+
+void EventManager::RemoveWaiter(int channel, int routine_id) {
+    std::vector<int>& waiters = channels[channel].waiters;
+    waiters.erase(std::remove(waiters.begin(), waiters.end(), routine_id), waiters.end());
+}
 
 void EventManager::Publish(std::string event_type, luabridge::LuaRef event_object) {
-    auto iter = subscribers.find(event_type);
-    if (iter != subscribers.end()) {
-        for (auto& [compRef, funcRef] : iter->second) {
-            if (!compRef.isNil() && !funcRef.isNil()) {
-                funcRef(compRef, event_object);
-            }
+    int channel = Find(event_type);
+    if(channel >= 0 && HasListeners(channel)) {
+        Deliver(channel, event_object);
+    }
+}
+
+int EventManager::PublishLua(lua_State* lua_state) {
+    int channel = ChannelOf(lua_state, 1, false);
+    if(channel < 0 || !HasListeners(channel)) {
+        return 0;
+    }
+    Deliver(channel, luabridge::LuaRef::fromStack(lua_state, 2));
+    return 0;
+}
+
+int EventManager::QueueLua(lua_State* lua_state) {
+    int channel = ChannelOf(lua_state, 1, true);
+    if(channel < 0) {
+        return 0;
+    }
+    // Coalesce: one delivery per channel per frame, latest object wins
+    EventChannel& ch = channels[channel];
+    ch.queued_object = luabridge::LuaRef::fromStack(lua_state, 2);
+    if(!ch.queued) {
+        ch.queued = true;
+        queued_channels.push_back(channel);
+    }
+    return 0;
+}
+
+void EventManager::ProcessQueue() {
+    std::vector<int> delivering;
+    delivering.swap(queued_channels);
+    for(int channel : delivering) {
+        luabridge::LuaRef event_object = channels[channel].queued_object;
+        channels[channel].queued = false;
+        channels[channel].queued_object = luabridge::LuaRef(ComponentDB::GetLuaState());
+        if(HasListeners(channel)) {
+            Deliver(channel, event_object);
         }
     }
 }
 
+int64_t EventManager::AddSubscription(int channel, const luabridge::LuaRef& component, const luabridge::LuaRef& function) {
+    EventChannel& ch = channels[channel];
+    int slot;
+    if(!ch.free_slots.empty()) {
+        slot = ch.free_slots.back();
+        ch.free_slots.pop_back();
+        ch.slots[slot].component = component;
+        ch.slots[slot].function = function;
+    } else {
+        slot = static_cast<int>(ch.slots.size());
+        ch.slots.push_back({component, function, 0, SLOT_FREE});
+    }
+    ch.slots[slot].state = SLOT_PENDING;
+    int64_t handle = MakeHandle(channel, ch.slots[slot].generation, slot);
+    pendingSubscriptions.push_back(handle);
+    return handle;
+}
+
 void EventManager::Subscribe(std::string event_type, luabridge::LuaRef component, luabridge::LuaRef function) {
-    pendingSubscriptions.push_back(std::make_pair(event_type, std::make_pair(component, function)));
+    AddSubscription(Intern(component.state(), event_type), component, function);
+}
+
+int EventManager::SubscribeLua(lua_State* lua_state) {
+    int channel = ChannelOf(lua_state, 1, true);
+    if(channel < 0) {
+        return 0;
+    }
+    lua_pushinteger(lua_state, AddSubscription(channel, luabridge::LuaRef::fromStack(lua_state, 2), luabridge::LuaRef::fromStack(lua_state, 3)));
+    return 1;
+}
+
+void EventManager::RemoveMatching(int channel, const luabridge::LuaRef& component, const luabridge::LuaRef& function) {
+    EventChannel& ch = channels[channel];
+    for(size_t i = 0; i < ch.slots.size(); ++i) {
+        Slot& s = ch.slots[i];
+        if(s.state != SLOT_FREE && s.component == component && s.function == function) {
+            pendingUnsubscriptions.push_back(MakeHandle(channel, s.generation, static_cast<int>(i)));
+        }
+    }
 }
 
 void EventManager::Unsubscribe(std::string event_type, luabridge::LuaRef component, luabridge::LuaRef function) {
-    pendingUnsubscriptions.push_back(std::make_pair(event_type, std::make_pair(component, function)));
+    int channel = Find(event_type);
+    if(channel >= 0) {
+        RemoveMatching(channel, component, function);
+    }
+}
+
+int EventManager::UnsubscribeLua(lua_State* lua_state) {
+    // Unsubscribe(handle) or the original Unsubscribe(event_type, component, function)
+    if(lua_gettop(lua_state) == 1 && lua_isinteger(lua_state, 1)) {
+        pendingUnsubscriptions.push_back(lua_tointeger(lua_state, 1));
+        return 0;
+    }
+    int channel = ChannelOf(lua_state, 1, false);
+    if(channel >= 0) {
+        RemoveMatching(channel, luabridge::LuaRef::fromStack(lua_state, 2), luabridge::LuaRef::fromStack(lua_state, 3));
+    }
+    return 0;
 }
 
 void EventManager::ProcessSubscriptions() {
-    for (auto& [event_type, sub] : pendingSubscriptions) {
-        subscribers[event_type].push_back(sub);
+    for (int64_t handle : pendingSubscriptions) {
+        Slot* s = SlotOf(handle);
+        if(s != nullptr && s->state == SLOT_PENDING) {
+            s->state = SLOT_ACTIVE;
+            ++channels[handle >> 48].active;
+        }
     }
     pendingSubscriptions.clear();
 }
 
 void EventManager::ProcessUnsubscriptions() {
-    for (auto& subscription : pendingUnsubscriptions) {
-        const auto& event_type = subscription.first;
-        const auto& unsub = subscription.second;
-        auto& subs = subscribers[event_type];
-
-        auto it = std::remove_if(subs.begin(), subs.end(), [&unsub](const std::pair<luabridge::LuaRef, luabridge::LuaRef>& current) {
-            return current == unsub;
-        });
-        
-        subs.erase(it, subs.end());
+    for (int64_t handle : pendingUnsubscriptions) {
+        Slot* s = SlotOf(handle);
+        if(s == nullptr) {
+            continue;
+        }
+        EventChannel& ch = channels[handle >> 48];
+        if(s->state == SLOT_ACTIVE) {
+            --ch.active;
+        }
+        // Drop the refs now; bump the generation so stale handles miss
+        s->component = luabridge::LuaRef(ComponentDB::GetLuaState());
+        s->function = luabridge::LuaRef(ComponentDB::GetLuaState());
+        s->state = SLOT_FREE;
+        ++s->generation;
+        ch.free_slots.push_back(static_cast<int>(handle & 0xFFFFFF));
     }
     pendingUnsubscriptions.clear();
 }
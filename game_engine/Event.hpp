@@ -10,21 +10,68 @@
 
 #include <stdio.h>
 #include <string>
+#include <deque>
+#include <vector>
+#include <unordered_map>
 #include "lua.hpp"
 #include "LuaBridge.h"
 
+// Event types are interned into integer channels. Each channel keeps its
+// subscribers in a slot array with a free list, so a subscription handle
+// removes in O(1). Subscribe/Unsubscribe still take effect at frame end.
 class EventManager {
 public:
+    static int Channel(std::string event_type);
+    
     static void Publish(std::string event_type, luabridge::LuaRef event_object);
     static void Subscribe(std::string event_type, luabridge::LuaRef component, luabridge::LuaRef function);
     static void Unsubscribe(std::string event_type, luabridge::LuaRef component, luabridge::LuaRef function);
     
+    // Lua entry points, accept a channel id or an event type name
+    static int PublishLua(lua_State* lua_state);
+    static int QueueLua(lua_State* lua_state);
+    static int SubscribeLua(lua_State* lua_state);
+    static int UnsubscribeLua(lua_State* lua_state);
+    
+    static int ChannelOf(lua_State* lua_state, int index, bool create);
+    static void AddWaiter(int channel, int routine_id);
+    static void RemoveWaiter(int channel, int routine_id);
+    
+    static void ProcessQueue();
     static void ProcessSubscriptions();
     static void ProcessUnsubscriptions();
 private:
-    static inline std::unordered_map<std::string, std::vector<std::pair<luabridge::LuaRef, luabridge::LuaRef>>> subscribers;
-    static inline std::vector<std::pair<std::string, std::pair<luabridge::LuaRef, luabridge::LuaRef> > > pendingSubscriptions;
-    static inline std::vector<std::pair<std::string, std::pair<luabridge::LuaRef, luabridge::LuaRef>>> pendingUnsubscriptions;
+    enum SlotState { SLOT_FREE, SLOT_PENDING, SLOT_ACTIVE };
+    
+    struct Slot {
+        luabridge::LuaRef component;
+        luabridge::LuaRef function;
+        uint32_t generation = 0;
+        SlotState state = SLOT_FREE;
+    };
+    
+    struct EventChannel {
+        std::deque<Slot> slots; // deque so handlers can subscribe mid-publish
+        std::vector<int> free_slots;
+        int active = 0;
+        std::vector<int> waiters; // coroutines in WaitUntilEvent
+        bool queued = false;
+        luabridge::LuaRef queued_object;
+    };
+    
+    static inline std::unordered_map<std::string, int> channel_ids;
+    static inline std::deque<EventChannel> channels;
+    static inline std::vector<int> queued_channels;
+    static inline std::vector<int64_t> pendingSubscriptions;
+    static inline std::vector<int64_t> pendingUnsubscriptions;
+    
+    static int Intern(lua_State* lua_state, const std::string& event_type);
+    static int Find(const std::string& event_type);
+    static bool HasListeners(int channel);
+    static void Deliver(int channel, const luabridge::LuaRef& event_object);
+    static int64_t AddSubscription(int channel, const luabridge::LuaRef& component, const luabridge::LuaRef& function);
+    static void RemoveMatching(int channel, const luabridge::LuaRef& component, const luabridge::LuaRef& function);
+    static Slot* SlotOf(int64_t handle);
 };
 
 #endif /* Event_hpp */
@@ -6,6 +6,8 @@
 //
 
 #include "ImageDB.hpp"
+#include "AssetManifest.hpp"
+#include "TextureCache.hpp"
 
 void Image::Clear() {
     SDL_SetRenderDrawColor(Scene::renderer, clear_color_r, clear_color_g, clear_color_b, 255);
@@ -18,20 +20,27 @@ void Image::Initialize() {
     Scene::window = Helper::SDL_CreateWindow498(game_title.c_str(), SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, Camera::resolution.x, Camera::resolution.y, 0);
     Scene::renderer = Helper::SDL_CreateRenderer498(Scene::window, -1, SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_ACCELERATED);
     Clear();
-    Scene::Load(config["initial_scene"].GetString());
-    Scene::LoadScene(config["initial_scene"].GetString());
 }
 
-void Image::DrawUI(std::string image_name, float x, float y) {
-    if(loaded_imgs.find(image_name) == loaded_imgs.end()) {
-        std::filesystem::path path = resources/"images"/(image_name +".png");
-        if(!std::filesystem::exists(path)) {
-            std::cout << "error: missing image " + image_name;
-            exit(0);
-        }
-        loaded_imgs[image_name] = IMG_LoadTexture(Scene::renderer, path.string().c_str());
+SDL_Texture* Image::Load(const std::string& image_name) {
+    AssetManifest::Requested(AssetKind::Image, image_name);
+    SDL_Texture* cached = TextureCache::Find(image_name);
+    if(cached != nullptr) {
+        return cached;
+    }
+    std::filesystem::path path = resources/"images"/(image_name +".png");
+    if(!std::filesystem::exists(path)) {
+        Logger::Flush();
+        std::cout << "error: missing image " + image_name;
+        exit(0);
     }
-    SDL_Texture* texture = loaded_imgs[image_name];
+    AssetManifest::Loaded();
+    SDL_Texture* texture = IMG_LoadTexture(Scene::renderer, path.string().c_str());
+    return TextureCache::Insert(image_name, texture);
+}
+
+void Image::DrawUI(std::string image_name, float x, float y) {
+    SDL_Texture* texture = Load(image_name);
     int width, height;
     SDL_QueryTexture(texture, NULL, NULL, &width, &height);
     SDL_Rect rect = {static_cast<int>(x), static_cast<int>(y), width, height};
@@ -41,15 +50,7 @@ void Image::DrawUI(std::string image_name, float x, float y) {
 }
 
 void Image::DrawUIEx(std::string image_name, float x, float y, float r, float g, float b, float a, float sorting_order) {
-    if(loaded_imgs.find(image_name) == loaded_imgs.end()) {
-        std::filesystem::path path = resources/"images"/(image_name +".png");
-        if(!std::filesystem::exists(path)) {
-            std::cout << "error: missing image " + image_name;
-            exit(0);
-        }
-        loaded_imgs[image_name] = IMG_LoadTexture(Scene::renderer, path.string().c_str());
-    }
-    SDL_Texture* texture = loaded_imgs[image_name];
+    SDL_Texture* texture = Load(image_name);
     int width, height;
     SDL_QueryTexture(texture, NULL, NULL, &width, &height);
     SDL_Rect rect = {static_cast<int>(x), static_cast<int>(y), width, height};
@@ -59,15 +60,7 @@ void Image::DrawUIEx(std::string image_name, float x, float y, float r, float g,
 }
 
 void Image::Draw(std::string image_name, float x, float y) {
-    if(loaded_imgs.find(image_name) == loaded_imgs.end()) {
-        std::filesystem::path path = resources/"images"/(image_name +".png");
-        if(!std::filesystem::exists(path)) {
-            std::cout << "error: missing image " + image_name;
-            exit(0);
-        }
-        loaded_imgs[image_name] = IMG_LoadTexture(Scene::renderer, path.string().c_str());
-    }
-    SDL_Texture* texture = loaded_imgs[image_name];
+    SDL_Texture* texture = Load(image_name);
     int width, height;
     SDL_QueryTexture(texture, NULL, NULL, &width, &height);
     SDL_Color color = {255, 255, 255, 255};
@@ -83,15 +76,7 @@ void Image::Draw(std::string image_name, float x, float y) {
 }
 
 void Image::DrawEx(std::string image_name, float x, float y, float rot_deg, float scale_x, float scale_y, float pivot_x, float pivot_y, float r, float g, float b, float a, float sorting_order) {
-    if(loaded_imgs.find(image_name) == loaded_imgs.end()) {
-        std::filesystem::path path = resources/"images"/(image_name +".png");
-        if(!std::filesystem::exists(path)) {
-            std::cout << "error: missing image " + image_name;
-            exit(0);
-        }
-        loaded_imgs[image_name] = IMG_LoadTexture(Scene::renderer, path.string().c_str());
-    }
-    SDL_Texture* texture = loaded_imgs[image_name];
+    SDL_Texture* texture = Load(image_name);
     SDL_Color color = {static_cast<Uint8>(r), static_cast<Uint8>(g), static_cast<Uint8>(b), static_cast<Uint8>(a)};
     glm::vec2 cam_adj_pos = glm::vec2(x, y) - Camera::camera_pos;
     SDL_Rect rect;
@@ -19,10 +19,9 @@
 
 class Image {
 public:
-    static inline std::unordered_map<std::string, SDL_Texture*> loaded_imgs;
-    
     static void Initialize();
     static void Clear();
+    static SDL_Texture* Load(const std::string& image_name);
     static void DrawUI(std::string image_name, float x, float y);
     static void DrawUIEx(std::string image_name, float x, float y, float r, float g, float b, float a, float sorting_order);
     static void Draw(std::string image_name, float x, float y);
@@ -1,111 +1,173 @@
 #include "Input.hpp"
 #include "SDL2/SDL.h"
+#include "lua.hpp"
+#include "LuaBridge.h"
 #include <iostream>
 #include <unordered_map>
 #include <vector>
+#include <algorithm>
 
 /* Code provided in EECS 498.007 W24 Lecture 9 */
 void Input::Init() {
-    for(int code= SDL_SCANCODE_UNKNOWN; code < SDL_NUM_SCANCODES; ++code) {
-        keyboard_states[static_cast<SDL_Scancode>(code)] = INPUT_STATE_UP;
-    }
-    for(int i=1; i<4; ++i) {
-        mouse_button_states[i] = INPUT_STATE_UP;
-    }
+    keyboard_states.fill(INPUT_STATE_UP);
+    mouse_button_states.fill(INPUT_STATE_UP);
 }
 void Input::ProcessEvent(const SDL_Event& e) {
     if(e.type == SDL_KEYDOWN) {
         keyboard_states[e.key.keysym.scancode] = INPUT_STATE_JUST_BECAME_DOWN;
-        just_became_down_scancodes.push_back(e.key.keysym.scancode);
+        just_became_down_scancodes.set(e.key.keysym.scancode);
     }
     else if(e.type == SDL_KEYUP) {
         keyboard_states[e.key.keysym.scancode] = INPUT_STATE_JUST_BECAME_UP;
-        just_became_up_scancodes.push_back(e.key.keysym.scancode);
+        just_became_up_scancodes.set(e.key.keysym.scancode);
     }
     else if (e.type == SDL_MOUSEMOTION) {
         mouse_position.x = e.motion.x;
         mouse_position.y = e.motion.y;
     }
-    else if (e.type == SDL_MOUSEBUTTONDOWN) {
+    else if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button < num_mouse_buttons) {
         mouse_button_states[e.button.button] = INPUT_STATE_JUST_BECAME_DOWN;
-        just_became_down_buttons.push_back(e.button.button);
+        just_became_down_buttons.set(e.button.button);
     }
-    else if (e.type == SDL_MOUSEBUTTONUP) {
+    else if (e.type == SDL_MOUSEBUTTONUP && e.button.button < num_mouse_buttons) {
         mouse_button_states[e.button.button] = INPUT_STATE_JUST_BECAME_UP;
-        just_became_up_buttons.push_back(e.button.button);
+        just_became_up_buttons.set(e.button.button);
     }
     else if(e.type == SDL_MOUSEWHEEL) {
         mouse_scroll_this_frame = e.wheel.preciseY;
     }
 }
 void Input::LateUpdate() {
-    for(const SDL_Scancode& code : just_became_down_scancodes) {
-        keyboard_states[code] = INPUT_STATE_DOWN;
-    }
-    just_became_down_scancodes.clear();
-    
-    for(const SDL_Scancode& code : just_became_up_scancodes) {
-        keyboard_states[code] = INPUT_STATE_UP;
+    // Settle this frame's transitions; downs first so a tap ends up
+    if(just_became_down_scancodes.any() || just_became_up_scancodes.any()) {
+        for(int code = 0; code < SDL_NUM_SCANCODES; ++code) {
+            if(just_became_down_scancodes.test(code)) {
+                keyboard_states[code] = INPUT_STATE_DOWN;
+            }
+            if(just_became_up_scancodes.test(code)) {
+                keyboard_states[code] = INPUT_STATE_UP;
+            }
+        }
+        just_became_down_scancodes.reset();
+        just_became_up_scancodes.reset();
     }
-    just_became_up_scancodes.clear();
     
-    for(const int& idx : just_became_down_buttons) {
-        mouse_button_states[idx] = INPUT_STATE_DOWN;
-    }
-    just_became_down_buttons.clear();
-    
-    for(const int& idx : just_became_up_buttons) {
-        mouse_button_states[idx] = INPUT_STATE_UP;
-    }
-    just_became_up_buttons.clear();
+    for(int idx = 0; idx < num_mouse_buttons; ++idx) {
+        if(just_became_down_buttons.test(idx)) {
+            mouse_button_states[idx] = INPUT_STATE_DOWN;
+        }
+        if(just_became_up_buttons.test(idx)) {
+            mouse_button_states[idx] = INPUT_STATE_UP;
+        }
+    }
+    just_became_down_buttons.reset();
+    just_became_up_buttons.reset();
     mouse_scroll_this_frame = 0.0;
 }
 
-bool Input::GetKey(std::string keycode) {
-    try {
-        SDL_Scancode k = __keycode_to_scancode.at(keycode);
-        return keyboard_states[k] == INPUT_STATE_DOWN || keyboard_states[k] == INPUT_STATE_JUST_BECAME_DOWN;
-    }
-    catch (const std::out_of_range &e){
+bool Input::GetKey(int scancode) {
+    if(scancode <= SDL_SCANCODE_UNKNOWN || scancode >= SDL_NUM_SCANCODES) {
         return false;
     }
+    return keyboard_states[scancode] == INPUT_STATE_DOWN || keyboard_states[scancode] == INPUT_STATE_JUST_BECAME_DOWN;
 }
-bool Input::GetKeyDown(std::string keycode) {
-    try {
-        SDL_Scancode k = __keycode_to_scancode.at(keycode);
-        return keyboard_states[k] == INPUT_STATE_JUST_BECAME_DOWN;
+bool Input::GetKeyDown(int scancode) {
+    if(scancode <= SDL_SCANCODE_UNKNOWN || scancode >= SDL_NUM_SCANCODES) {
+        return false;
     }
-    catch (const std::out_of_range &e){
+    return keyboard_states[scancode] == INPUT_STATE_JUST_BECAME_DOWN;
+}
+bool Input::GetKeyUp(int scancode) {
+    if(scancode <= SDL_SCANCODE_UNKNOWN || scancode >= SDL_NUM_SCANCODES) {
         return false;
     }
+    return keyboard_states[scancode] == INPUT_STATE_JUST_BECAME_UP;
+}
+
+static SDL_Scancode LookupKeycode(const std::string& keycode) {
+    auto it = __keycode_to_scancode.find(keycode);
+    return it == __keycode_to_scancode.end() ? SDL_SCANCODE_UNKNOWN : it->second;
+}
+bool Input::GetKey(const std::string& keycode) {
+    return GetKey(LookupKeycode(keycode));
 }
-bool Input::GetKeyUp(std::string keycode) {
-    try {
-        SDL_Scancode k = __keycode_to_scancode.at(keycode);
-        return keyboard_states[k] == INPUT_STATE_JUST_BECAME_UP;
+bool Input::GetKeyDown(const std::string& keycode) {
+    return GetKeyDown(LookupKeycode(keycode));
+}
+bool Input::GetKeyUp(const std::string& keycode) {
+    return GetKeyUp(LookupKeycode(keycode));
+}
+
+SDL_Scancode Input::ScancodeOf(lua_State* lua_state) {
+    if(lua_isinteger(lua_state, 1)) {
+        return static_cast<SDL_Scancode>(lua_tointeger(lua_state, 1));
     }
-    catch (const std::out_of_range &e){
-        return false;
+    if(lua_type(lua_state, 1) == LUA_TSTRING) {
+        return LookupKeycode(lua_tostring(lua_state, 1));
     }
+    return SDL_SCANCODE_UNKNOWN;
+}
+int Input::GetKeyLua(lua_State* lua_state) {
+    lua_pushboolean(lua_state, GetKey(ScancodeOf(lua_state)));
+    return 1;
+}
+int Input::GetKeyDownLua(lua_State* lua_state) {
+    lua_pushboolean(lua_state, GetKeyDown(ScancodeOf(lua_state)));
+    return 1;
+}
+int Input::GetKeyUpLua(lua_State* lua_state) {
+    lua_pushboolean(lua_state, GetKeyUp(ScancodeOf(lua_state)));
+    return 1;
+}
+
+// Input.KEY_<NAME> for every key name scripts can pass as a string
+void Input::RegisterKeyConstants(lua_State* lua_state) {
+    static const std::unordered_map<std::string, std::string> symbol_names = {
+        {"/", "SLASH"}, {";", "SEMICOLON"}, {"=", "EQUALS"}, {"-", "MINUS"}, {".", "PERIOD"},
+        {",", "COMMA"}, {"[", "LEFTBRACKET"}, {"]", "RIGHTBRACKET"}, {"\\", "BACKSLASH"}, {"'", "APOSTROPHE"}
+    };
+    lua_getglobal(lua_state, "Input");
+    for(const auto& [keycode, scancode] : __keycode_to_scancode) {
+        auto symbol = symbol_names.find(keycode);
+        std::string name = symbol != symbol_names.end() ? symbol->second : keycode;
+        std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+        lua_pushstring(lua_state, ("KEY_" + name).c_str());
+        lua_pushinteger(lua_state, scancode);
+        lua_rawset(lua_state, -3);
+    }
+    lua_pop(lua_state, 1);
 }
 
 glm::vec2 Input::GetMousePosition() {
     return mouse_position;
 }
+int Input::GetMousePositionInto(lua_State* lua_state) {
+    if(lua_isnoneornil(lua_state, 1)) {
+        return luaL_error(lua_state, "GetMousePositionInto needs a vec2 to write into");
+    }
+    glm::vec2* out = luabridge::Stack<glm::vec2*>::get(lua_state, 1);
+    *out = mouse_position;
+    return 0;
+}
+int Input::GetMousePositionXY(lua_State* lua_state) {
+    lua_pushnumber(lua_state, mouse_position.x);
+    lua_pushnumber(lua_state, mouse_position.y);
+    return 2;
+}
 bool Input::GetMouseButton(int button) {
-    if(button > 0 && button < 4) {
+    if(button > 0 && button < num_mouse_buttons) {
         return mouse_button_states[button] == INPUT_STATE_DOWN || mouse_button_states[button] == INPUT_STATE_JUST_BECAME_DOWN;
     }
     return false;
 }
 bool Input::GetMouseButtonDown(int button) {
-    if(button > 0 && button < 4) {
+    if(button > 0 && button < num_mouse_buttons) {
         return mouse_button_states[button] == INPUT_STATE_JUST_BECAME_DOWN;
     }
     return false;
 }
 bool Input::GetMouseButtonUp(int button) {
-    if(button > 0 && button < 4) {
+    if(button > 0 && button < num_mouse_buttons) {
         return mouse_button_states[button] == INPUT_STATE_JUST_BECAME_UP;
     }
     return false;
@@ -3,10 +3,15 @@
 
 #include <unordered_map>
 #include <vector>
+#include <array>
+#include <bitset>
+#include <string>
 #include "SDL2/SDL.h"
 #include "glm/glm.hpp"
 #include "Keycode_To_Scancode.h"
 
+struct lua_State;
+
 enum INPUT_STATE { INPUT_STATE_UP, INPUT_STATE_JUST_BECAME_DOWN, INPUT_STATE_DOWN, INPUT_STATE_JUST_BECAME_UP };
 
 class Input
@@ -16,11 +21,22 @@ public:
     static void ProcessEvent(const SDL_Event & e); // Call every frame at start of event loop.
     static void LateUpdate();
 
-    static bool GetKey(std::string keycode);
-    static bool GetKeyDown(std::string keycode);
-    static bool GetKeyUp(std::string keycode);
+    static bool GetKey(const std::string& keycode);
+    static bool GetKeyDown(const std::string& keycode);
+    static bool GetKeyUp(const std::string& keycode);
+    static bool GetKey(int scancode);
+    static bool GetKeyDown(int scancode);
+    static bool GetKeyUp(int scancode);
+    
+    // Lua entry points, accept a key name or an Input.KEY_* constant
+    static int GetKeyLua(lua_State* lua_state);
+    static int GetKeyDownLua(lua_State* lua_state);
+    static int GetKeyUpLua(lua_State* lua_state);
+    static void RegisterKeyConstants(lua_State* lua_state);
     
     static glm::vec2 GetMousePosition();
+    static int GetMousePositionInto(lua_State* lua_state);
+    static int GetMousePositionXY(lua_State* lua_state);
     
     static bool GetMouseButton(int button);
     static bool GetMouseButtonDown(int button);
@@ -28,16 +44,20 @@ public:
     static float GetMouseScrollDelta();
 
 private:
-    static inline std::unordered_map<SDL_Scancode, INPUT_STATE> keyboard_states;
-    static inline std::vector<SDL_Scancode> just_became_down_scancodes;
-    static inline std::vector<SDL_Scancode> just_became_up_scancodes;
+    static const int num_mouse_buttons = 8;
+    
+    static inline std::array<INPUT_STATE, SDL_NUM_SCANCODES> keyboard_states;
+    static inline std::bitset<SDL_NUM_SCANCODES> just_became_down_scancodes;
+    static inline std::bitset<SDL_NUM_SCANCODES> just_became_up_scancodes;
     
     static inline glm::vec2 mouse_position;
     
-    static inline std::unordered_map<int, INPUT_STATE> mouse_button_states;
-    static inline std::vector<int> just_became_down_buttons;
-    static inline std::vector<int> just_became_up_buttons;
+    static inline std::array<INPUT_STATE, num_mouse_buttons> mouse_button_states;
+    static inline std::bitset<num_mouse_buttons> just_became_down_buttons;
+    static inline std::bitset<num_mouse_buttons> just_became_up_buttons;
     static inline float mouse_scroll_this_frame = 0.0;
+    
+    static SDL_Scancode ScancodeOf(lua_State* lua_state);
 };
 
 #endif
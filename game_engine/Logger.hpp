@@ -0,0 +1,79 @@
+//
+//  Logger.hpp
+//  game_engine
+//
+//  Created by Jasmine Li on 4/27/24.
+//
+
+#ifndef Logger_hpp
+#define Logger_hpp
+
+#include <stdio.h>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <unordered_map>
+
+enum class LogLevel { Debug = 0, Info, Warning, Error };
+
+// How an entry is shown on the console
+enum class LogStyle { Out, Err, Highlight };
+
+// Buffered logging. Writers push into a lock-free ring and a background
+// thread does the console/file I/O in batches. Until Initialize runs, or with
+// log_async off, everything is written straight through; log_async defaults to
+// on only when stdout is a terminal. Anything else that writes to the console
+// directly (fatal errors, reports) calls Flush first so output stays in order.
+class Logger {
+public:
+    static void Initialize();
+    static void Write(LogLevel level, const std::string& message, LogStyle style = LogStyle::Out);
+    static void Flush();
+    static void FrameEnd();
+    static void Shutdown();
+
+    static void SetLevel(std::string name);
+    static std::string GetLevel();
+    static int GetSuppressedCount();
+
+private:
+    struct Entry {
+        std::atomic<size_t> sequence;
+        LogLevel level;
+        LogStyle style;
+        int frame;
+        std::string text;
+    };
+    static constexpr size_t capacity = 4096; // power of two
+
+    static inline Entry ring[capacity];
+    static inline std::atomic<size_t> enqueue_pos = 0;
+    static inline size_t dequeue_pos = 0;
+    static inline std::atomic<size_t> written = 0;
+
+    static inline std::thread worker;
+    static inline std::atomic<bool> running = false;
+    static inline std::mutex wake_mutex;
+    static inline std::condition_variable wake;
+
+    static inline LogLevel min_level = LogLevel::Debug;
+    static inline std::ofstream file;
+    static inline std::atomic<int> frame = 0;
+
+    // Per-frame repeat limiting (main thread only)
+    static inline int repeat_limit = 0; // <= 0 turns limiting off
+    static inline std::thread::id main_thread;
+    static inline std::unordered_map<std::string, int> repeats;
+    static inline int suppressed = 0;
+
+    static void Run();
+    static size_t Drain(std::string& out, std::string& err);
+    static void Emit(LogLevel level, LogStyle style, int entry_frame, const std::string& text, std::string& out, std::string& err);
+    static void WriteFile(LogLevel level, int entry_frame, const std::string& text);
+    static bool Suppress(const std::string& message);
+};
+
+#endif /* Logger_hpp */
@@ -0,0 +1,40 @@
+//
+//  LuaGC.hpp
+//  game_engine
+//
+//  Created by Jasmine Li on 4/23/24.
+//
+
+#ifndef LuaGC_hpp
+#define LuaGC_hpp
+
+#include <stdio.h>
+#include <string>
+
+// Schedules Lua garbage collection into the idle part of the frame instead of
+// letting it land on whichever script allocates.
+class LuaGC {
+public:
+    static inline bool generational = true;
+    static inline float budget_ms = 2.0f;
+    static inline int step_kb = 32;
+    static inline bool report = false;
+
+    static void Initialize();
+    static void Step();
+    static void Collect();
+
+    static void SetBudget(float ms);
+    static float GetBudget();
+    static float GetHeapKB();
+    static float GetStepTime();
+    static int GetStepCount();
+
+private:
+    static inline float heap_kb = 0.0f;
+    static inline float step_ms = 0.0f;
+    static inline int step_count = 0;
+    static inline int last_kb = 0; // heap after the last step
+};
+
+#endif /* LuaGC_hpp */
@@ -0,0 +1,133 @@
+//
+//  Profiler.cpp
+//  game_engine
+//
+//  Created by Jasmine Li on 4/25/24.
+//
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include "Profiler.hpp"
+#include "ComponentDB.hpp"
+#include "SceneDB.hpp"
+#include "EngineUtils.h"
+
+static const int max_sample_depth = 64;
+
+void Profiler::Initialize() {
+    if(config.HasMember("profiler")) {
+        enabled = config["profiler"].GetBool();
+    }
+    std::string env = EngineUtils::GetEnvVariable("LUA_PROFILE");
+    if(!env.empty()) {
+        enabled = env != "0";
+    }
+    if(!enabled) {
+        return;
+    }
+    if(config.HasMember("profiler_sample_count")) {
+        sample_count = std::max(config["profiler_sample_count"].GetInt(), 1);
+    }
+    if(config.HasMember("profiler_output")) {
+        output = config["profiler_output"].GetString();
+    }
+    last_sample = std::chrono::steady_clock::now();
+    lua_sethook(ComponentDB::GetLuaState(), Hook, LUA_MASKCOUNT, sample_count);
+    // Scripts and errors leave through exit(), so write from there
+    std::atexit(Write);
+}
+
+void Profiler::Hook(lua_State* lua_state, lua_Debug*) {
+    auto now = std::chrono::steady_clock::now();
+    double weight = std::chrono::duration<double, std::micro>(now - last_sample).count();
+    last_sample = now;
+
+    // Walk from the leaf outwards, then fold root first
+    std::vector<std::string> frames;
+    lua_Debug frame;
+    for(int level = 0; level < max_sample_depth && lua_getstack(lua_state, level, &frame); ++level) {
+        lua_getinfo(lua_state, "Sln", &frame);
+        std::string name = frame.name ? frame.name : (frame.what[0] == 'm' ? "main" : "?");
+        if(frame.currentline > 0) {
+            frames.push_back(name + "@" + frame.short_src + ":" + std::to_string(frame.currentline));
+        } else {
+            frames.push_back(name + "@" + frame.short_src);
+        }
+    }
+    std::string type = current_type ? *current_type : "[other]";
+    std::string stack = type;
+    if(current_function) {
+        stack += ";";
+        stack += current_function;
+    }
+    for(auto it = frames.rbegin(); it != frames.rend(); ++it) {
+        stack += ";" + *it;
+    }
+    folded[stack] += weight;
+    sampled_us[type] += weight;
+}
+
+void Profiler::EndDispatch(const std::string& type, const char* function, std::chrono::steady_clock::time_point start) {
+    auto now = std::chrono::steady_clock::now();
+    double us = std::chrono::duration<double, std::micro>(now - start).count();
+    DispatchStats& stats = dispatches[type + "\t" + function];
+    ++stats.calls;
+    stats.total_us += us;
+    stats.max_us = std::max(stats.max_us, us);
+    last_sample = now;
+}
+
+void Profiler::Write() {
+    if(!enabled) {
+        return;
+    }
+    enabled = false;
+    lua_sethook(ComponentDB::GetLuaState(), nullptr, 0, 0);
+
+    std::ofstream folded_file(output + ".folded");
+    for(const auto& [stack, us] : folded) {
+        long long weight = static_cast<long long>(us + 0.5);
+        if(weight > 0) {
+            folded_file << stack << " " << weight << "\n";
+        }
+    }
+
+    // Per type totals, then the per function breakdown
+    std::unordered_map<std::string, DispatchStats> types;
+    for(const auto& [key, stats] : dispatches) {
+        DispatchStats& type_stats = types[key.substr(0, key.find('\t'))];
+        type_stats.calls += stats.calls;
+        type_stats.total_us += stats.total_us;
+        type_stats.max_us = std::max(type_stats.max_us, stats.max_us);
+    }
+    auto by_total = [](const auto& a, const auto& b) {
+        return a.second.total_us > b.second.total_us;
+    };
+    std::vector<std::pair<std::string, DispatchStats>> type_rows(types.begin(), types.end());
+    std::vector<std::pair<std::string, DispatchStats>> function_rows(dispatches.begin(), dispatches.end());
+    std::sort(type_rows.begin(), type_rows.end(), by_total);
+    std::sort(function_rows.begin(), function_rows.end(), by_total);
+
+    std::ofstream summary(output + "_summary.txt");
+    summary << std::fixed << std::setprecision(2);
+    summary << std::left << std::setw(32) << "type" << std::right << std::setw(12) << "calls"
+            << std::setw(14) << "total ms" << std::setw(12) << "max us" << std::setw(14) << "sampled ms" << "\n";
+    for(const auto& [type, stats] : type_rows) {
+        summary << std::left << std::setw(32) << type << std::right << std::setw(12) << stats.calls
+                << std::setw(14) << stats.total_us / 1000.0 << std::setw(12) << stats.max_us
+                << std::setw(14) << sampled_us[type] / 1000.0 << "\n";
+    }
+    summary << "\n" << std::left << std::setw(32) << "type.function" << std::right << std::setw(12) << "calls"
+            << std::setw(14) << "total ms" << std::setw(12) << "avg us" << std::setw(12) << "max us" << "\n";
+    for(const auto& [key, stats] : function_rows) {
+        std::string name = key;
+        name[key.find('\t')] = '.';
+        summary << std::left << std::setw(32) << name << std::right << std::setw(12) << stats.calls
+                << std::setw(14) << stats.total_us / 1000.0 << std::setw(12) << stats.total_us / stats.calls
+                << std::setw(12) << stats.max_us << "\n";
+    }
+}
@@ -0,0 +1,84 @@
+//
+//  Profiler.hpp
+//  game_engine
+//
+//  Created by Jasmine Li on 4/25/24.
+//
+
+#ifndef Profiler_hpp
+#define Profiler_hpp
+
+#include <stdio.h>
+#include <string>
+#include <chrono>
+#include <unordered_map>
+#include "lua.hpp"
+
+// Sampling Lua profiler. A count hook samples the Lua stack every
+// sample_count instructions and weights each sample by the time since the
+// previous one; lifecycle dispatches are also timed natively per component
+// type. Turned on with "profiler": true in game.config or LUA_PROFILE=1.
+// Writes <output>.folded (flame graph input) and <output>_summary.txt at exit.
+class Profiler {
+public:
+    static inline bool enabled = false;
+    static inline int sample_count = 1000;
+    static inline std::string output = "profile";
+
+    static void Initialize();
+    static void Write();
+
+private:
+    friend class ProfileScope;
+
+    struct DispatchStats {
+        long long calls = 0;
+        double total_us = 0.0;
+        double max_us = 0.0;
+    };
+
+    static inline const std::string* current_type = nullptr;
+    static inline const char* current_function = nullptr;
+    static inline std::chrono::steady_clock::time_point last_sample;
+    static inline std::unordered_map<std::string, double> folded;
+    static inline std::unordered_map<std::string, DispatchStats> dispatches;
+    static inline std::unordered_map<std::string, double> sampled_us;
+
+    static void Hook(lua_State* lua_state, lua_Debug* ar);
+    static void EndDispatch(const std::string& type, const char* function, std::chrono::steady_clock::time_point start);
+};
+
+// Times one lifecycle dispatch; only a branch when the profiler is off
+class ProfileScope {
+public:
+    ProfileScope(const std::string& type, const char* function) {
+        if(!Profiler::enabled) {
+            return;
+        }
+        this->type = &type;
+        this->function = function;
+        previous_type = Profiler::current_type;
+        previous_function = Profiler::current_function;
+        Profiler::current_type = &type;
+        Profiler::current_function = function;
+        start = std::chrono::steady_clock::now();
+        Profiler::last_sample = start;
+    }
+    ~ProfileScope() {
+        if(type == nullptr) {
+            return;
+        }
+        Profiler::EndDispatch(*type, function, start);
+        Profiler::current_type = previous_type;
+        Profiler::current_function = previous_function;
+    }
+
+private:
+    const std::string* type = nullptr;
+    const char* function = nullptr;
+    const std::string* previous_type = nullptr;
+    const char* previous_function = nullptr;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif /* Profiler_hpp */
@@ -0,0 +1,315 @@
+//
+//  Region.cpp
+//  game_engine
+//
+//  Created by Jasmine Li on 4/22/24.
+//
+
+#include <cmath>
+#include "Region.hpp"
+#include "SceneDB.hpp"
+#include "Rigidbody.hpp"
+
+// Actor is active if it has no tracked bodies or at least one body inside the window
+static void RefreshActor(Actor* actor) {
+    if(actor == nullptr) {
+        return;
+    }
+    bool active = actor->region_bodies == 0 || actor->region_bodies_inside > 0;
+    if(active == actor->active) {
+        return;
+    }
+    actor->active = active;
+    if(active) {
+        actor->OnActivate();
+    } else {
+        actor->OnDeactivate();
+    }
+}
+
+void Region::Initialize() {
+    if(config.HasMember("activity_radius")) {
+        radius = config["activity_radius"].GetFloat();
+    }
+    if(config.HasMember("activity_cell_size")) {
+        cell_size = config["activity_cell_size"].GetFloat();
+    }
+    if(radius > 0.0f) {
+        ComputeWindow(window_min, window_max);
+    }
+}
+
+glm::ivec2 Region::CellOf(Rigidbody* rb) {
+    b2Vec2 pos = rb->body->GetPosition();
+    return glm::ivec2(static_cast<int>(std::floor(pos.x / cell_size)), static_cast<int>(std::floor(pos.y / cell_size)));
+}
+
+bool Region::InWindow(glm::ivec2 cell) {
+    if(radius <= 0.0f) {
+        return true;
+    }
+    return cell.x >= window_min.x && cell.x <= window_max.x && cell.y >= window_min.y && cell.y <= window_max.y;
+}
+
+void Region::AddToCell(Rigidbody* rb, glm::ivec2 cell) {
+    std::vector<Rigidbody*>& bucket = cells[EngineUtils::create_composite_key(cell.x, cell.y)];
+    rb->region_cell = cell;
+    rb->region_index = static_cast<int>(bucket.size());
+    bucket.push_back(rb);
+}
+
+void Region::RemoveFromCell(Rigidbody* rb) {
+    auto it = cells.find(EngineUtils::create_composite_key(rb->region_cell.x, rb->region_cell.y));
+    if(it == cells.end() || rb->region_index < 0) {
+        return;
+    }
+    // Swap-remove so removal is O(1)
+    std::vector<Rigidbody*>& bucket = it->second;
+    Rigidbody* last = bucket.back();
+    bucket[rb->region_index] = last;
+    last->region_index = rb->region_index;
+    bucket.pop_back();
+    rb->region_index = -1;
+    if(bucket.empty()) {
+        cells.erase(it);
+    }
+}
+
+void Region::SetInside(Rigidbody* rb, bool inside) {
+    if(rb->region_inside == inside) {
+        return;
+    }
+    rb->region_inside = inside;
+    rb->body->SetEnabled(inside);
+    if(inside) {
+        --inactive_bodies;
+        if(rb->actor) {
+            ++rb->actor->region_bodies_inside;
+        }
+    } else {
+        ++inactive_bodies;
+        if(rb->actor) {
+            --rb->actor->region_bodies_inside;
+        }
+    }
+    if(rb->actor) {
+        refresh.push_back(rb->actor);
+    }
+}
+
+// OnActivate/OnDeactivate can add or remove bodies, so they only fire once a
+// scan over cells is finished. Actors on their way out get neither.
+void Region::RefreshActors() {
+    std::vector<Actor*> actors;
+    actors.swap(refresh);
+    for(Actor* actor : actors) {
+        if(!Actor::IsDestroyed(actor)) {
+            RefreshActor(actor);
+        }
+    }
+}
+
+void Region::Insert(Rigidbody* rb) {
+    AddToCell(rb, CellOf(rb));
+    ++total_bodies;
+    rb->region_inside = true;
+    if(rb->actor) {
+        ++rb->actor->region_bodies;
+        ++rb->actor->region_bodies_inside;
+    }
+    SetInside(rb, InWindow(rb->region_cell));
+    RefreshActors();
+}
+
+void Region::Remove(Rigidbody* rb) {
+    if(rb->region_index < 0) {
+        return;
+    }
+    RemoveFromCell(rb);
+    --total_bodies;
+    if(!rb->region_inside) {
+        --inactive_bodies;
+    }
+    if(rb->actor) {
+        --rb->actor->region_bodies;
+        if(rb->region_inside) {
+            --rb->actor->region_bodies_inside;
+        }
+        // Runs from OnDestroy, mid-way through the actor's own queue; refreshed in Actor::FrameEnd
+        if(!Actor::IsDestroyed(rb->actor)) {
+            refresh.push_back(rb->actor);
+        }
+    }
+}
+
+void Region::Reset() {
+    // Bodies are owned by the world being cleared; only forget them here
+    cells.clear();
+    refresh.clear();
+    inactive_bodies = 0;
+    total_bodies = 0;
+}
+
+void Region::Resync() {
+    if(radius <= 0.0f) {
+        return;
+    }
+    // Bodies were changed behind our back (e.g. a physics snapshot restore)
+    std::vector<Rigidbody*> all;
+    for(auto& [key, bucket] : cells) {
+        all.insert(all.end(), bucket.begin(), bucket.end());
+    }
+    cells.clear();
+    for(Rigidbody* rb : all) {
+        AddToCell(rb, CellOf(rb));
+        bool enabled = rb->body->IsEnabled();
+        if(enabled != rb->region_inside) {
+            rb->region_inside = enabled;
+            inactive_bodies += enabled ? -1 : 1;
+            if(rb->actor) {
+                rb->actor->region_bodies_inside += enabled ? 1 : -1;
+            }
+        }
+        SetInside(rb, InWindow(rb->region_cell));
+        if(rb->actor) {
+            refresh.push_back(rb->actor);
+        }
+    }
+    RefreshActors();
+}
+
+void Region::ComputeWindow(glm::ivec2& min, glm::ivec2& max) {
+    int r = static_cast<int>(std::ceil(radius / cell_size));
+    glm::ivec2 center = glm::ivec2(static_cast<int>(std::floor(Camera::camera_pos.x / cell_size)), static_cast<int>(std::floor(Camera::camera_pos.y / cell_size)));
+    min = center - glm::ivec2(r, r);
+    max = center + glm::ivec2(r, r);
+}
+
+void Region::Update() {
+    if(radius <= 0.0f) {
+        return;
+    }
+    glm::ivec2 old_min = window_min;
+    glm::ivec2 old_max = window_max;
+    glm::ivec2 new_min;
+    glm::ivec2 new_max;
+    ComputeWindow(new_min, new_max);
+
+    // Re-bucket bodies that moved within the active window; only those can move
+    std::vector<std::pair<Rigidbody*, glm::ivec2>> moved;
+    for(int cx = old_min.x; cx <= old_max.x; ++cx) {
+        for(int cy = old_min.y; cy <= old_max.y; ++cy) {
+            auto it = cells.find(EngineUtils::create_composite_key(cx, cy));
+            if(it == cells.end()) {
+                continue;
+            }
+            for(Rigidbody* rb : it->second) {
+                if(!rb->body->IsAwake()) {
+                    continue;
+                }
+                glm::ivec2 cell = CellOf(rb);
+                if(cell != rb->region_cell) {
+                    moved.push_back({rb, cell});
+                }
+            }
+        }
+    }
+    for(auto& [rb, cell] : moved) {
+        RemoveFromCell(rb);
+        AddToCell(rb, cell);
+    }
+
+    window_min = new_min;
+    window_max = new_max;
+
+    // Bodies that left the window on their own
+    for(auto& [rb, cell] : moved) {
+        if(!InWindow(cell)) {
+            SetInside(rb, false);
+        }
+    }
+
+    if(old_min == new_min && old_max == new_max) {
+        RefreshActors();
+        return;
+    }
+
+    // Cells that left the window are frozen in bulk
+    for(int cx = old_min.x; cx <= old_max.x; ++cx) {
+        for(int cy = old_min.y; cy <= old_max.y; ++cy) {
+            if(InWindow(glm::ivec2(cx, cy))) {
+                continue;
+            }
+            auto it = cells.find(EngineUtils::create_composite_key(cx, cy));
+            if(it == cells.end()) {
+                continue;
+            }
+            for(Rigidbody* rb : it->second) {
+                SetInside(rb, false);
+            }
+        }
+    }
+    // Cells that entered the window are woken in bulk
+    for(int cx = new_min.x; cx <= new_max.x; ++cx) {
+        for(int cy = new_min.y; cy <= new_max.y; ++cy) {
+            if(cx >= old_min.x && cx <= old_max.x && cy >= old_min.y && cy <= old_max.y) {
+                continue;
+            }
+            auto it = cells.find(EngineUtils::create_composite_key(cx, cy));
+            if(it == cells.end()) {
+                continue;
+            }
+            for(Rigidbody* rb : it->second) {
+                SetInside(rb, true);
+            }
+        }
+    }
+    RefreshActors();
+}
+
+void Region::SetRadius(float r) {
+    // Bodies can't be enabled or disabled mid-step (e.g. from OnCollisionEnter)
+    if(Physics::DeferIfLocked([r] { SetRadius(r); })) {
+        return;
+    }
+    radius = r;
+    if(radius > 0.0f) {
+        ComputeWindow(window_min, window_max);
+    }
+    // Re-evaluate every body against the new window
+    for(auto& [key, bucket] : cells) {
+        for(Rigidbody* rb : bucket) {
+            SetInside(rb, InWindow(rb->region_cell));
+        }
+    }
+    RefreshActors();
+}
+
+float Region::GetRadius() {
+    return radius;
+}
+
+void Region::SetCellSize(float size) {
+    if(size <= 0.0f || Physics::DeferIfLocked([size] { SetCellSize(size); })) {
+        return;
+    }
+    cell_size = size;
+    // Re-bucket everything under the new cell size
+    std::vector<Rigidbody*> all;
+    for(auto& [key, bucket] : cells) {
+        all.insert(all.end(), bucket.begin(), bucket.end());
+    }
+    cells.clear();
+    for(Rigidbody* rb : all) {
+        AddToCell(rb, CellOf(rb));
+    }
+    SetRadius(radius);
+}
+
+int Region::GetActiveBodyCount() {
+    return total_bodies - inactive_bodies;
+}
+
+int Region::GetInactiveBodyCount() {
+    return inactive_bodies;
+}
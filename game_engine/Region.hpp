@@ -0,0 +1,58 @@
+//
+//  Region.hpp
+//  game_engine
+//
+//  Created by Jasmine Li on 4/22/24.
+//
+
+#ifndef Region_hpp
+#define Region_hpp
+
+#include <stdio.h>
+#include <unordered_map>
+#include <vector>
+#include "glm/glm.hpp"
+
+class Rigidbody;
+class Actor;
+
+// Keeps simulation running only near the camera. Rigidbodies are bucketed
+// into a grid of cells; cells outside the active window around the camera
+// have their bodies disabled and their actors skip Update/LateUpdate.
+class Region {
+public:
+    static inline float radius = 0.0f; // <= 0 turns regional simulation off
+    static inline float cell_size = 10.0f;
+
+    static void Initialize();
+    static void Update();
+    static void Reset();
+    static void Resync();
+
+    static void Insert(Rigidbody* rb);
+    static void Remove(Rigidbody* rb);
+    static void RefreshActors();
+
+    static void SetRadius(float r);
+    static float GetRadius();
+    static void SetCellSize(float size);
+    static int GetActiveBodyCount();
+    static int GetInactiveBodyCount();
+
+private:
+    static inline std::unordered_map<uint64_t, std::vector<Rigidbody*>> cells;
+    static inline glm::ivec2 window_min = glm::ivec2(1, 1);
+    static inline glm::ivec2 window_max = glm::ivec2(0, 0);
+    static inline int inactive_bodies = 0;
+    static inline int total_bodies = 0;
+    static inline std::vector<Actor*> refresh; // actors whose bodies changed during a scan
+
+    static void ComputeWindow(glm::ivec2& min, glm::ivec2& max);
+    static glm::ivec2 CellOf(Rigidbody* rb);
+    static bool InWindow(glm::ivec2 cell);
+    static void SetInside(Rigidbody* rb, bool inside);
+    static void AddToCell(Rigidbody* rb, glm::ivec2 cell);
+    static void RemoveFromCell(Rigidbody* rb);
+};
+
+#endif /* Region_hpp */
@@ -6,7 +6,10 @@
 //
 
 #include "Rigidbody.hpp"
+#include <box2d/b2_time_of_impact.h>
 #include "glm/glm.hpp"
+#include "Region.hpp"
+#include "SceneDB.hpp"
 
 void CollisionDetector::BeginContact(b2Contact* contact) {
     b2Fixture* fixtureA = contact->GetFixtureA();
@@ -69,6 +72,127 @@ void Physics::Step() {
     if(Physics::world != nullptr) {
         Physics::world->Step((1.0f/60.0f), 8, 3);
     }
+    // Work queued from contact callbacks, which run while the world is locked
+    std::vector<std::function<void()>> actions;
+    actions.swap(deferred);
+    for(auto& action : actions) {
+        action();
+    }
+}
+
+bool Physics::DeferIfLocked(std::function<void()> action) {
+    if(Physics::world == nullptr || !Physics::world->IsLocked()) {
+        return false;
+    }
+    deferred.push_back(std::move(action));
+    return true;
+}
+
+void Physics::ResetWorld(const std::vector<Actor*>& persistent_actors) {
+    // Ids stay unique, so a stale id can't restore onto the next scene's bodies
+    snapshots.clear();
+    if(Physics::world == nullptr) {
+        return;
+    }
+    // Save bodies of DontDestroy actors so they can be rebuilt after the bulk clear
+    struct PersistentBody {
+        Rigidbody* rb;
+        b2Vec2 position;
+        float angle;
+        b2Vec2 velocity;
+        float angular_velocity;
+        bool awake;
+        // Setters write the body directly, so take these from it rather than the members
+        b2BodyType type;
+        float gravity_scale;
+        float linear_damping;
+        float angular_damping;
+    };
+    std::vector<PersistentBody> persistent;
+    for(Actor* a : persistent_actors) {
+        for(auto& c : a->components) {
+            if(c.second.type != "Rigidbody") {
+                continue;
+            }
+            Rigidbody* rb = c.second.componentRef->cast<Rigidbody*>();
+            if(rb->body == nullptr) {
+                continue;
+            }
+            b2Body* body = rb->body;
+            persistent.push_back({rb, body->GetPosition(), body->GetAngle(), body->GetLinearVelocity(), body->GetAngularVelocity(), body->IsAwake(), body->GetType(), body->GetGravityScale(), body->GetLinearDamping(), body->GetAngularDamping()});
+        }
+    }
+    
+    // Drop every body, fixture, contact and proxy at once, keeping the allocator's chunks
+    Region::Reset();
+    for(Actor* a : persistent_actors) {
+        a->region_bodies = 0;
+        a->region_bodies_inside = 0;
+    }
+    Physics::world->Reset();
+    
+    for(PersistentBody& p : persistent) {
+        p.rb->x = p.position.x;
+        p.rb->y = p.position.y;
+        p.rb->rotation = radToDeg(p.angle);
+        p.rb->CreateBody();
+        p.rb->body->SetType(p.type);
+        p.rb->body->SetGravityScale(p.gravity_scale);
+        p.rb->body->SetLinearDamping(p.linear_damping);
+        p.rb->body->SetAngularDamping(p.angular_damping);
+        p.rb->body->SetLinearVelocity(p.velocity);
+        p.rb->body->SetAngularVelocity(p.angular_velocity);
+        p.rb->body->SetAwake(p.awake);
+    }
+}
+
+int Physics::Snapshot() {
+    if(Physics::world == nullptr) {
+        return -1;
+    }
+    int id = next_snapshot_id++;
+    std::vector<uint8_t>& buffer = snapshots[id];
+    buffer.resize(Physics::world->SaveSnapshot(nullptr));
+    Physics::world->SaveSnapshot(buffer.data());
+    return id;
+}
+
+bool Physics::Restore(int id) {
+    auto it = snapshots.find(id);
+    if(Physics::world == nullptr || it == snapshots.end()) {
+        return false;
+    }
+    // From a collision or trigger callback; restored once the step finishes
+    if(DeferIfLocked([id] { Restore(id); })) {
+        return true;
+    }
+    // Restores in place; fails if bodies were created or destroyed since the snapshot
+    if(!Physics::world->RestoreSnapshot(it->second.data(), static_cast<int32>(it->second.size()))) {
+        return false;
+    }
+    Region::Resync();
+    return true;
+}
+
+void Physics::DiscardSnapshot(int id) {
+    snapshots.erase(id);
+}
+
+// Solver scratch memory stats for the main thread, used to tune physics_stack_size
+int Physics::GetStackPeak() {
+    return b2StackAllocator::GetThreadAllocator().GetMaxAllocation();
+}
+
+int Physics::GetStackCapacity() {
+    return b2StackAllocator::GetThreadAllocator().GetCapacity();
+}
+
+int Physics::GetStackOverflows() {
+    return b2StackAllocator::GetThreadAllocator().GetOverflowCount();
+}
+
+void Physics::ResetStackStats() {
+    b2StackAllocator::GetThreadAllocator().ResetStats();
 }
 
 float RaycastFirstCallback::ReportFixture(b2Fixture* fixture, const b2Vec2 &point, const b2Vec2 &normal, float fraction) {
@@ -96,6 +220,7 @@ float RaycastAllCallback::ReportFixture(b2Fixture* fixture, const b2Vec2& point,
     hit.point = point;
     hit.normal = normal;
     hit.is_trigger = fixture->IsSensor();
+    hit.fraction = fraction;
     hits.push_back(hit);
     return 1.0f;
 }
@@ -114,6 +239,7 @@ HitResult Physics::Raycast(b2Vec2 pos, b2Vec2 dir, float dist) {
         result.point = callback._hitPoint;
         result.normal = callback._hitNormal;
         result.is_trigger = callback._hitFixture->IsSensor();
+        result.fraction = callback._fraction;
         return result;
     }
     return luabridge::LuaRef(ComponentDB::GetLuaState());
@@ -143,14 +269,140 @@ luabridge::LuaRef Physics::RaycastAll (b2Vec2 pos, b2Vec2 dir, float dist) {
     return hitResults;
 }
 
+bool ShapeCastCallback::ReportFixture(b2Fixture* fixture) {
+    if(fixture->GetUserData().pointer == 0) {
+        return true;
+    }
+    // Multi-child fixtures report once per child; keep one entry
+    if(fixtures.empty() || fixtures.back() != fixture) {
+        fixtures.push_back(fixture);
+    }
+    return true;
+}
+
+luabridge::LuaRef Physics::CircleCast(b2Vec2 pos, float radius, b2Vec2 dir, float dist) {
+    if(radius <= 0) {
+        return luabridge::LuaRef(ComponentDB::GetLuaState());
+    }
+    b2CircleShape circle;
+    circle.m_radius = radius;
+    return ShapeCast(circle, pos, dir, dist);
+}
+
+luabridge::LuaRef Physics::BoxCast(b2Vec2 pos, float width, float height, b2Vec2 dir, float dist) {
+    if(width <= 0 || height <= 0) {
+        return luabridge::LuaRef(ComponentDB::GetLuaState());
+    }
+    b2PolygonShape box;
+    box.SetAsBox(width * 0.5f, height * 0.5f);
+    return ShapeCast(box, pos, dir, dist);
+}
+
+luabridge::LuaRef Physics::ShapeCast(const b2Shape& shape, b2Vec2 pos, b2Vec2 dir, float dist) {
+    if(dist <= 0 || !Physics::world) {
+        return luabridge::LuaRef(ComponentDB::GetLuaState());
+    }
+    dir.Normalize();
+    b2Vec2 end = pos + dist * dir;
+
+    // Broadphase: everything touching the swept bounds
+    b2Transform start_xf(pos, b2Rot(0.0f));
+    b2Transform end_xf(end, b2Rot(0.0f));
+    b2AABB start_box;
+    b2AABB end_box;
+    shape.ComputeAABB(&start_box, start_xf, 0);
+    shape.ComputeAABB(&end_box, end_xf, 0);
+    b2AABB swept;
+    swept.Combine(start_box, end_box);
+    ShapeCastCallback callback;
+    Physics::world->QueryAABB(&callback, swept);
+
+    b2DistanceProxy cast_proxy;
+    cast_proxy.Set(&shape, 0);
+    b2Sweep cast_sweep;
+    cast_sweep.localCenter.SetZero();
+    cast_sweep.c0 = pos;
+    cast_sweep.c = end;
+    cast_sweep.a0 = 0.0f;
+    cast_sweep.a = 0.0f;
+    cast_sweep.alpha0 = 0.0f;
+
+    // Narrowphase: exact time of impact against each candidate
+    b2Fixture* hit_fixture = nullptr;
+    b2DistanceProxy hit_proxy;
+    float hit_fraction = 1.0f;
+    for(b2Fixture* fixture : callback.fixtures) {
+        b2Body* body = fixture->GetBody();
+        b2TOIInput input;
+        input.proxyB = cast_proxy;
+        input.sweepA.localCenter = body->GetLocalCenter();
+        input.sweepA.c0 = body->GetWorldCenter();
+        input.sweepA.c = input.sweepA.c0;
+        input.sweepA.a0 = body->GetAngle();
+        input.sweepA.a = input.sweepA.a0;
+        input.sweepA.alpha0 = 0.0f;
+        input.sweepB = cast_sweep;
+        input.tMax = hit_fraction;
+        for(int32 child = 0; child < fixture->GetShape()->GetChildCount(); ++child) {
+            input.proxyA.Set(fixture->GetShape(), child);
+            b2TOIOutput output;
+            b2TimeOfImpact(&output, &input);
+            bool hit = output.state == b2TOIOutput::e_touching || output.state == b2TOIOutput::e_overlapped;
+            if(hit && (hit_fixture == nullptr || output.t < hit_fraction)) {
+                hit_fixture = fixture;
+                hit_proxy = input.proxyA;
+                hit_fraction = output.t;
+                input.tMax = hit_fraction;
+            }
+        }
+    }
+    if(hit_fixture == nullptr) {
+        return luabridge::LuaRef(ComponentDB::GetLuaState());
+    }
+
+    // Contact point and normal from the closest features at the hit time
+    b2DistanceInput distance_input;
+    distance_input.proxyA = hit_proxy;
+    distance_input.proxyB = cast_proxy;
+    distance_input.transformA = hit_fixture->GetBody()->GetTransform();
+    distance_input.transformB = b2Transform(pos + hit_fraction * dist * dir, b2Rot(0.0f));
+    distance_input.useRadii = false;
+    b2SimplexCache cache;
+    cache.count = 0;
+    b2DistanceOutput distance_output;
+    b2Distance(&distance_output, &cache, &distance_input);
+
+    HitResult result;
+    result.actor = reinterpret_cast<Actor*>(hit_fixture->GetUserData().pointer);
+    result.normal = distance_output.pointB - distance_output.pointA;
+    if(result.normal.Normalize() < b2_epsilon) {
+        // Started inside the fixture; push back along the cast
+        result.normal = -dir;
+    }
+    result.point = distance_output.pointA + hit_proxy.m_radius * result.normal;
+    result.is_trigger = hit_fixture->IsSensor();
+    result.fraction = hit_fraction;
+    return luabridge::LuaRef(ComponentDB::GetLuaState(), result);
+}
+
 void Rigidbody::Ready() {
     // Create b2World object
     if(!Physics::world) {
         Physics::world = new b2World(b2Vec2(0.0f, 9.8f));
         Physics::collisionDetector = new CollisionDetector();
         Physics::world->SetContactListener(Physics::collisionDetector);
+        if(config.HasMember("physics_stack_size")) {
+            b2StackAllocator::GetThreadAllocator().Reserve(config["physics_stack_size"].GetInt());
+        }
     }
-    
+    if(body != nullptr) { // Recycled from an actor pool
+        ReviveBody();
+        return;
+    }
+    CreateBody();
+}
+
+void Rigidbody::CreateBody() {
     // Create body
     b2BodyDef body_def;
     if(body_type == "dynamic") {
@@ -225,10 +477,49 @@ void Rigidbody::Ready() {
     }
     
     SetRotation(rotation);
+    Region::Insert(this);
+}
+
+void Rigidbody::ReviveBody() {
+    // Parked bodies keep their fixtures; only the body settings are reapplied
+    if(body_type == "dynamic") {
+        body->SetType(b2_dynamicBody);
+    }
+    else if(body_type == "kinematic") {
+        body->SetType(b2_kinematicBody);
+    }
+    else if(body_type == "static") {
+        body->SetType(b2_staticBody);
+    }
+    body->SetTransform(b2Vec2(x, y), degToRad(rotation));
+    body->SetLinearVelocity(b2Vec2(0.0f, 0.0f));
+    body->SetAngularVelocity(0.0f);
+    body->SetBullet(precise);
+    body->SetGravityScale(gravity_scale);
+    body->SetAngularDamping(angular_friction);
+    body->SetEnabled(true);
+    Region::Insert(this);
 }
 
 void Rigidbody::OnDestroy() {
-    Physics::world->DestroyBody(body);
+    if(body == nullptr) {
+        return;
+    }
+    if(actor != nullptr && !actor->pool_template.empty()) {
+        // Pooled actors park the body disabled instead of destroying it
+        Region::Remove(this);
+        body->SetEnabled(false);
+        return;
+    }
+    DestroyBody();
+}
+
+void Rigidbody::DestroyBody() {
+    if(body != nullptr) {
+        Region::Remove(this);
+        Physics::world->DestroyBody(body);
+        body = nullptr;
+    }
 }
 
 b2Vec2 Rigidbody::GetPosition() {
@@ -260,6 +551,7 @@ void Rigidbody::SetAngularVelocity(float deg_clockwise) {
 }
 
 void Rigidbody::SetGravityScale(float scale) {
+    gravity_scale = scale;
     body->SetGravityScale(scale);
 }
 
@@ -281,6 +573,47 @@ b2Vec2 Rigidbody::GetVelocity() {
     return body->GetLinearVelocity();
 }
 
+// Argument 1 is the Rigidbody itself
+int Rigidbody::GetPositionInto(lua_State* lua_state) {
+    if(lua_isnoneornil(lua_state, 2)) {
+        return luaL_error(lua_state, "GetPositionInto needs a Vector2 to write into");
+    }
+    b2Vec2* out = luabridge::Stack<b2Vec2*>::get(lua_state, 2);
+    *out = body->GetPosition();
+    return 0;
+}
+
+int Rigidbody::GetVelocityInto(lua_State* lua_state) {
+    if(lua_isnoneornil(lua_state, 2)) {
+        return luaL_error(lua_state, "GetVelocityInto needs a Vector2 to write into");
+    }
+    b2Vec2* out = luabridge::Stack<b2Vec2*>::get(lua_state, 2);
+    *out = body->GetLinearVelocity();
+    return 0;
+}
+
+int Rigidbody::GetPositionXY(lua_State* lua_state) {
+    b2Vec2 pos = body->GetPosition();
+    lua_pushnumber(lua_state, pos.x);
+    lua_pushnumber(lua_state, pos.y);
+    return 2;
+}
+
+int Rigidbody::GetVelocityXY(lua_State* lua_state) {
+    b2Vec2 vel = body->GetLinearVelocity();
+    lua_pushnumber(lua_state, vel.x);
+    lua_pushnumber(lua_state, vel.y);
+    return 2;
+}
+
+void Rigidbody::SetPositionXY(float pos_x, float pos_y) {
+    SetPosition(b2Vec2(pos_x, pos_y));
+}
+
+void Rigidbody::SetVelocityXY(float vel_x, float vel_y) {
+    body->SetLinearVelocity(b2Vec2(vel_x, vel_y));
+}
+
 float Rigidbody::GetAngularVelocity() {
     return radToDeg(body->GetAngularVelocity());
 }
@@ -10,6 +10,8 @@
 
 #include <stdio.h>
 #include <string>
+#include <vector>
+#include <functional>
 #include <box2d/box2d.h>
 #include "Actor.hpp"
 
@@ -31,11 +33,12 @@ struct HitResult {
     b2Vec2 point;
     b2Vec2 normal;
     bool is_trigger;
+    float fraction = 0.0f;
 };
 
 class RaycastFirstCallback : public b2RayCastCallback {
 public:
-    b2Fixture* _hitFixture;
+    b2Fixture* _hitFixture = nullptr;
     b2Vec2 _hitPoint;
     b2Vec2 _hitNormal;
     float _fraction;
@@ -49,14 +52,42 @@ public:
     float ReportFixture(b2Fixture* fixture, const b2Vec2& point, const b2Vec2& normal, float fraction) override;
 };
 
+// Collects fixtures whose proxies overlap a swept shape's bounds
+class ShapeCastCallback : public b2QueryCallback {
+public:
+    std::vector<b2Fixture*> fixtures;
+
+    bool ReportFixture(b2Fixture* fixture) override;
+};
+
 class Physics {
+private:
+    static inline std::unordered_map<int, std::vector<uint8_t>> snapshots;
+    static inline int next_snapshot_id = 0;
+    static inline std::vector<std::function<void()>> deferred;
 public:
     static b2World* world;
     static CollisionDetector* collisionDetector;
     static void Step();
+    static void ResetWorld(const std::vector<Actor*>& persistent_actors);
+    static bool DeferIfLocked(std::function<void()> action);
+    
+    static int Snapshot();
+    static bool Restore(int id);
+    static void DiscardSnapshot(int id);
+    
+    static int GetStackPeak();
+    static int GetStackCapacity();
+    static int GetStackOverflows();
+    static void ResetStackStats();
     
     static HitResult Raycast(b2Vec2 pos, b2Vec2 dir, float dist);
     static luabridge::LuaRef RaycastAll (b2Vec2 pos, b2Vec2 dir, float dist);
+    static luabridge::LuaRef CircleCast(b2Vec2 pos, float radius, b2Vec2 dir, float dist);
+    static luabridge::LuaRef BoxCast(b2Vec2 pos, float width, float height, b2Vec2 dir, float dist);
+
+private:
+    static luabridge::LuaRef ShapeCast(const b2Shape& shape, b2Vec2 pos, b2Vec2 dir, float dist);
 };
 
 class Rigidbody {
@@ -91,6 +122,7 @@ public:
     
     void Ready();
     void OnDestroy();
+    void DestroyBody();
     
     b2Vec2 GetPosition();
     float GetRotation();
@@ -108,8 +140,25 @@ public:
     b2Vec2 GetUpDirection();
     b2Vec2 GetRightDirection();
     
+    // Allocation-free variants for hot script paths
+    int GetPositionInto(lua_State* lua_state);
+    int GetVelocityInto(lua_State* lua_state);
+    int GetPositionXY(lua_State* lua_state);
+    int GetVelocityXY(lua_State* lua_state);
+    void SetPositionXY(float pos_x, float pos_y);
+    void SetVelocityXY(float vel_x, float vel_y);
+    
 private:
-    b2Body* body;
+    friend class Physics;
+    friend class Region;
+    b2Body* body = nullptr;
+    
+    glm::ivec2 region_cell = glm::ivec2(0, 0);
+    int region_index = -1;
+    bool region_inside = true;
+    
+    void CreateBody();
+    void ReviveBody();
 };
 
 #endif /* Rigidbody_hpp */
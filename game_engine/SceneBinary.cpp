@@ -0,0 +1,608 @@
+//
+//  SceneBinary.cpp
+//  game_engine
+//
+//  Created by Jasmine Li on 4/28/24.
+//
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "SceneBinary.hpp"
+#include "SceneDB.hpp"
+#include "ComponentDB.hpp"
+#include "EngineUtils.h"
+
+static const char binary_magic[4] = {'S', 'C', 'B', '1'};
+static const uint32_t binary_version = 2;
+static const uint32_t none = 0xFFFFFFFF;
+
+enum ValueTag : uint32_t { TagInt = 0, TagDouble, TagString, TagBool };
+enum ComponentKind { KindUnresolved = 0, KindRigidbody, KindAnimation, KindLua };
+
+// Byte offsets of each section from the start of the file
+struct BinaryHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t file_size;
+    uint32_t string_count;
+    uint32_t strings_offset; // u32 offsets into the blob, then the blob
+    uint32_t dep_count;
+    uint32_t deps_offset; // {u32 path, u32 pad, u64 size, i64 mtime}
+    uint32_t type_count;
+    uint32_t types_offset; // u32 string ids
+    uint32_t template_count;
+    uint32_t templates_offset; // u32 record offsets
+    uint32_t actor_count;
+    uint32_t actors_offset; // u32 record offsets
+};
+
+// Record layout (all u32):
+//   actor:     template | name | component_count | component...
+//   component: key | type | override_count | override...
+//   override:  name | tag | value (int, string id, bool: 1 word; double: 2 words)
+
+class MappedFile {
+public:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    bool Open(const std::filesystem::path& path) {
+#ifdef _WIN32
+        file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER file_size;
+        if(!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+            return false;
+        }
+        mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(mapping == nullptr) {
+            return false;
+        }
+        data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        size = static_cast<size_t>(file_size.QuadPart);
+        return data != nullptr;
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if(fstat(fd, &info) != 0 || info.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(mapped == MAP_FAILED) {
+            return false;
+        }
+        data = static_cast<const uint8_t*>(mapped);
+        size = static_cast<size_t>(info.st_size);
+        return true;
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if(data) {
+            UnmapViewOfFile(data);
+        }
+        if(mapping) {
+            CloseHandle(mapping);
+        }
+        if(file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+#else
+        if(data) {
+            munmap(const_cast<uint8_t*>(data), size);
+        }
+#endif
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
+
+// JSON -> binary
+
+class SceneCompiler {
+public:
+    bool ok = true;
+
+    uint32_t Intern(const std::string& value) {
+        auto it = string_ids.find(value);
+        if(it != string_ids.end()) {
+            return it->second;
+        }
+        uint32_t id = static_cast<uint32_t>(string_offsets.size());
+        string_offsets.push_back(static_cast<uint32_t>(blob.size()));
+        blob.append(value);
+        blob.push_back('\0');
+        string_ids[value] = id;
+        return id;
+    }
+
+    void AddDependency(const std::filesystem::path& path) {
+        Dependency dep;
+        dep.path = Intern(std::filesystem::relative(path, resources).generic_string());
+        if(!EngineUtils::GetFileStamp(path, dep.size, dep.mtime)) {
+            ok = false;
+        }
+        deps.push_back(dep);
+    }
+
+    uint32_t CompileActor(rapidjson::Value& a) {
+        std::vector<uint32_t> record;
+        record.push_back(a.HasMember("template") ? TemplateId(a["template"].GetString()) : none);
+        record.push_back(a.HasMember("name") ? Intern(a["name"].GetString()) : none);
+        if(!a.HasMember("components")) {
+            record.push_back(0);
+            return Append(record);
+        }
+        record.push_back(a["components"].MemberCount());
+        for (auto& c : a["components"].GetObject()) {
+            record.push_back(Intern(c.name.GetString()));
+            record.push_back(c.value.HasMember("type") ? TypeId(c.value["type"].GetString()) : none);
+            // Same value filtering as ComponentDB::OverrideComponentInstance
+            size_t count_index = record.size();
+            record.push_back(0);
+            for (auto& pair : c.value.GetObject()) {
+                uint32_t name = Intern(pair.name.GetString());
+                switch (pair.value.GetType()) {
+                    case rapidjson::kNumberType:
+                        if (pair.value.IsDouble()) {
+                            double value = pair.value.GetDouble();
+                            uint32_t words[2];
+                            std::memcpy(words, &value, sizeof(value));
+                            record.insert(record.end(), {name, TagDouble, words[0], words[1]});
+                        } else if (pair.value.IsInt()) {
+                            record.insert(record.end(), {name, TagInt, static_cast<uint32_t>(pair.value.GetInt())});
+                        } else {
+                            continue;
+                        }
+                        break;
+                    case rapidjson::kStringType:
+                        record.insert(record.end(), {name, TagString, Intern(pair.value.GetString())});
+                        break;
+                    case rapidjson::kTrueType:
+                    case rapidjson::kFalseType:
+                        record.insert(record.end(), {name, TagBool, pair.value.GetBool() ? 1u : 0u});
+                        break;
+                    default:
+                        continue;
+                }
+                ++record[count_index];
+            }
+        }
+        return Append(record);
+    }
+
+    std::vector<uint32_t> actors;
+
+    bool Write(const std::filesystem::path& path) {
+        BinaryHeader header = {};
+        std::memcpy(header.magic, binary_magic, 4);
+        header.version = binary_version;
+
+        uint32_t offset = sizeof(BinaryHeader);
+        header.string_count = static_cast<uint32_t>(string_offsets.size());
+        header.strings_offset = offset;
+        offset += header.string_count * 4;
+        uint32_t blob_offset = offset;
+        offset += static_cast<uint32_t>((blob.size() + 3) & ~size_t(3));
+        header.dep_count = static_cast<uint32_t>(deps.size());
+        header.deps_offset = offset;
+        offset += header.dep_count * 24;
+        header.type_count = static_cast<uint32_t>(types.size());
+        header.types_offset = offset;
+        offset += header.type_count * 4;
+        header.template_count = static_cast<uint32_t>(templates.size());
+        header.templates_offset = offset;
+        offset += header.template_count * 4;
+        header.actor_count = static_cast<uint32_t>(actors.size());
+        header.actors_offset = offset;
+        offset += header.actor_count * 4;
+        uint32_t records_offset = offset;
+        offset += static_cast<uint32_t>(records.size() * 4);
+        header.file_size = offset;
+
+        std::string out;
+        out.reserve(offset);
+        out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        for(uint32_t string_offset : string_offsets) {
+            uint32_t absolute = blob_offset + string_offset;
+            out.append(reinterpret_cast<const char*>(&absolute), 4);
+        }
+        out.append(blob);
+        out.resize(header.deps_offset, '\0');
+        for(const Dependency& dep : deps) {
+            uint32_t pad = 0;
+            out.append(reinterpret_cast<const char*>(&dep.path), 4);
+            out.append(reinterpret_cast<const char*>(&pad), 4);
+            out.append(reinterpret_cast<const char*>(&dep.size), 8);
+            out.append(reinterpret_cast<const char*>(&dep.mtime), 8);
+        }
+        out.append(reinterpret_cast<const char*>(types.data()), types.size() * 4);
+        for(uint32_t index : templates) {
+            uint32_t absolute = records_offset + index * 4;
+            out.append(reinterpret_cast<const char*>(&absolute), 4);
+        }
+        for(uint32_t index : actors) {
+            uint32_t absolute = records_offset + index * 4;
+            out.append(reinterpret_cast<const char*>(&absolute), 4);
+        }
+        out.append(reinterpret_cast<const char*>(records.data()), records.size() * 4);
+
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path(), ec);
+        // Write beside and rename so a crash never leaves a torn file
+        std::filesystem::path tmp_path = path;
+        tmp_path += ".tmp";
+        {
+            std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+            if(!file || !file.write(out.data(), out.size())) {
+                return false;
+            }
+        }
+        std::filesystem::rename(tmp_path, path, ec);
+        return !ec;
+    }
+
+private:
+    struct Dependency {
+        uint32_t path = 0;
+        uint64_t size = 0;
+        int64_t mtime = 0;
+    };
+
+    std::unordered_map<std::string, uint32_t> string_ids;
+    std::vector<uint32_t> string_offsets;
+    std::string blob;
+    std::vector<Dependency> deps;
+    std::unordered_map<std::string, uint32_t> type_ids;
+    std::vector<uint32_t> types;
+    std::unordered_map<std::string, uint32_t> template_ids;
+    std::vector<uint32_t> templates;
+    std::vector<std::unique_ptr<ScratchJsonDocument>> template_docs;
+    std::vector<uint32_t> records;
+
+    uint32_t Append(const std::vector<uint32_t>& record) {
+        uint32_t index = static_cast<uint32_t>(records.size());
+        records.insert(records.end(), record.begin(), record.end());
+        return index;
+    }
+
+    uint32_t TypeId(const std::string& type) {
+        auto it = type_ids.find(type);
+        if(it != type_ids.end()) {
+            return it->second;
+        }
+        uint32_t id = static_cast<uint32_t>(types.size());
+        types.push_back(Intern(type));
+        type_ids[type] = id;
+        return id;
+    }
+
+    uint32_t TemplateId(const std::string& name) {
+        auto it = template_ids.find(name);
+        if(it != template_ids.end()) {
+            // none marks a template still being compiled, i.e. a cycle
+            ok = ok && it->second != none;
+            return it->second;
+        }
+        template_ids[name] = none;
+        std::filesystem::path path = resources / "actor_templates" / (name + ".template");
+        if(!std::filesystem::exists(path)) {
+            // Leave the error to the JSON loader
+            ok = false;
+            return none;
+        }
+        AddDependency(path);
+        template_docs.push_back(std::make_unique<ScratchJsonDocument>());
+        EngineUtils::ReadJsonFile(path.generic_string(), *template_docs.back());
+        uint32_t record = CompileActor(*template_docs.back());
+        // Ids are handed out after the record so a template always follows the ones it names
+        uint32_t id = static_cast<uint32_t>(templates.size());
+        templates.push_back(record);
+        template_ids[name] = id;
+        return id;
+    }
+};
+
+// Binary -> actors
+
+class SceneLoader {
+public:
+    const uint8_t* data;
+    size_t size;
+    BinaryHeader header;
+    bool ok = true;
+
+    SceneLoader(const uint8_t* data, size_t size) : data(data), size(size) {
+        if(size < sizeof(BinaryHeader)) {
+            ok = false;
+            return;
+        }
+        std::memcpy(&header, data, sizeof(header));
+        ok = std::memcmp(header.magic, binary_magic, 4) == 0 && header.version == binary_version && header.file_size == size;
+        ok = ok && InBounds(header.strings_offset, header.string_count * 4ull) && InBounds(header.deps_offset, header.dep_count * 24ull) && InBounds(header.types_offset, header.type_count * 4ull) && InBounds(header.templates_offset, header.template_count * 4ull) && InBounds(header.actors_offset, header.actor_count * 4ull);
+        for(uint32_t i = 0; ok && i < header.string_count; ++i) {
+            uint32_t offset = Word(header.strings_offset + i * 4);
+            ok = offset < size && std::memchr(data + offset, '\0', size - offset) != nullptr;
+        }
+        kinds.assign(header.type_count, KindUnresolved);
+    }
+
+    bool Fresh() {
+        for(uint32_t i = 0; i < header.dep_count; ++i) {
+            size_t offset = header.deps_offset + i * 24;
+            uint64_t size = 0;
+            int64_t mtime = 0;
+            uint64_t stored_size;
+            int64_t stored_mtime;
+            std::memcpy(&stored_size, data + offset + 8, 8);
+            std::memcpy(&stored_mtime, data + offset + 16, 8);
+            if(Word(offset) >= header.string_count || !EngineUtils::GetFileStamp(resources / String(Word(offset)), size, mtime) || size != stored_size || mtime != stored_mtime) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Walks every record once so a damaged file is rejected before any actor exists
+    bool Validate() {
+        for(uint32_t i = 0; ok && i < header.type_count; ++i) {
+            ok = Word(header.types_offset + i * 4) < header.string_count;
+        }
+        // Templates are written dependencies first, so each may only name an earlier one
+        for(uint32_t i = 0; ok && i < header.template_count; ++i) {
+            ValidateActor(Word(header.templates_offset + i * 4), i);
+        }
+        for(uint32_t i = 0; ok && i < header.actor_count; ++i) {
+            ValidateActor(Word(header.actors_offset + i * 4), header.template_count);
+        }
+        return ok;
+    }
+
+    Actor BuildActor(uint32_t offset) {
+        uint32_t template_id = Word(offset);
+        uint32_t name = Word(offset + 4);
+        uint32_t count = Word(offset + 8);
+        offset += 12;
+        Actor new_actor;
+        if(template_id != none) {
+            new_actor = BuildActor(Word(header.templates_offset + template_id * 4));
+            for(uint32_t i = 0; i < count; ++i) {
+                std::string key = String(Word(offset));
+                uint32_t type_id = Word(offset + 4);
+                // Keys inherited from the template keep the template's type
+                std::string type;
+                ComponentKind kind;
+                auto existing = new_actor.components.find(key);
+                if(existing != new_actor.components.end()) {
+                    type = existing->second.type;
+                    kind = KindOf(type);
+                } else {
+                    type = type_id == none ? "" : String(header.types_offset, type_id);
+                    kind = type_id == none ? KindOf(type) : KindOf(type_id);
+                }
+                offset = AddComponent(new_actor, key, type, kind, offset + 8);
+            }
+            // Add components to lifecycle queues
+            new_actor.onstart_queue.clear();
+            for(auto& c : new_actor.components) {
+                new_actor.onstart_queue.push_back(c.first);
+                new_actor.update_queue.push_back(c.first);
+                new_actor.lateupdate_queue.push_back(c.first);
+            }
+            new_actor.actor_name = name != none ? String(name) : new_actor.actor_name;
+        } else {
+            new_actor = Actor(n_actors, name != none ? String(name) : "", "");
+            for(uint32_t i = 0; i < count; ++i) {
+                std::string key = String(Word(offset));
+                uint32_t type_id = Word(offset + 4);
+                offset = AddComponent(new_actor, key, String(header.types_offset, type_id), KindOf(type_id), offset + 8);
+            }
+            for(auto& c : new_actor.components) {
+                new_actor.onstart_queue.push_back(c.first);
+                new_actor.update_queue.push_back(c.first);
+                new_actor.lateupdate_queue.push_back(c.first);
+            }
+        }
+        return new_actor;
+    }
+
+private:
+    std::vector<ComponentKind> kinds;
+
+    bool InBounds(uint64_t offset, uint64_t length) {
+        return offset + length <= size;
+    }
+
+    uint32_t Word(size_t offset) {
+        uint32_t value;
+        std::memcpy(&value, data + offset, 4);
+        return value;
+    }
+
+    const char* String(uint32_t id) {
+        return reinterpret_cast<const char*>(data + Word(header.strings_offset + id * 4));
+    }
+
+    const char* String(uint32_t table_offset, uint32_t index) {
+        return String(Word(table_offset + index * 4));
+    }
+
+    ComponentKind KindOf(const std::string& type) {
+        if(type == "Rigidbody") {
+            return KindRigidbody;
+        }
+        if(type == "Animation") {
+            return KindAnimation;
+        }
+        if(ComponentDB::HasComponentType(type)) {
+            return KindLua;
+        }
+        Logger::Flush();
+        std::cout << "error: failed to locate component " << type;
+        exit(0);
+    }
+
+    // Type table entries are resolved once per load
+    ComponentKind KindOf(uint32_t type_id) {
+        if(kinds[type_id] == KindUnresolved) {
+            kinds[type_id] = KindOf(std::string(String(header.types_offset, type_id)));
+        }
+        return kinds[type_id];
+    }
+
+    uint32_t AddComponent(Actor& actor, const std::string& key, const std::string& type, ComponentKind kind, uint32_t offset) {
+        std::shared_ptr<luabridge::LuaRef> component_instance;
+        if(kind == KindRigidbody) {
+            component_instance = ComponentDB::CreateRigidbody(key);
+        } else if(kind == KindAnimation) {
+            component_instance = ComponentDB::CreateAnimation(key);
+        } else {
+            component_instance = ComponentDB::CreateComponentInstance(key, type);
+        }
+        uint32_t count = Word(offset);
+        offset += 4;
+        for(uint32_t i = 0; i < count; ++i) {
+            const char* name = String(Word(offset));
+            uint32_t tag = Word(offset + 4);
+            offset += 8;
+            switch (tag) {
+                case TagInt:
+                    (*component_instance)[name] = static_cast<int>(Word(offset));
+                    offset += 4;
+                    break;
+                case TagDouble: {
+                    double value;
+                    std::memcpy(&value, data + offset, sizeof(value));
+                    (*component_instance)[name] = value;
+                    offset += 8;
+                    break;
+                }
+                case TagString:
+                    (*component_instance)[name] = String(Word(offset));
+                    offset += 4;
+                    break;
+                case TagBool:
+                    (*component_instance)[name] = Word(offset) != 0;
+                    offset += 4;
+                    break;
+            }
+        }
+        actor.components[key] = Component(key, type, component_instance);
+        return offset;
+    }
+
+    void ValidateActor(uint32_t offset, uint32_t template_limit) {
+        if(!InBounds(offset, 12)) {
+            ok = false;
+            return;
+        }
+        uint32_t template_id = Word(offset);
+        uint32_t name = Word(offset + 4);
+        uint32_t count = Word(offset + 8);
+        ok = (template_id == none || template_id < template_limit) && (name == none || name < header.string_count);
+        offset += 12;
+        for(uint32_t i = 0; ok && i < count; ++i) {
+            if(!InBounds(offset, 12)) {
+                ok = false;
+                return;
+            }
+            uint32_t key = Word(offset);
+            uint32_t type_id = Word(offset + 4);
+            uint32_t overrides = Word(offset + 8);
+            ok = key < header.string_count && (type_id < header.type_count || (type_id == none && template_id != none));
+            offset += 12;
+            for(uint32_t j = 0; ok && j < overrides; ++j) {
+                if(!InBounds(offset, 12)) {
+                    ok = false;
+                    return;
+                }
+                uint32_t tag = Word(offset + 4);
+                ok = Word(offset) < header.string_count && tag <= TagBool && (tag != TagString || Word(offset + 8) < header.string_count);
+                offset += tag == TagDouble ? 16 : 12;
+                ok = ok && InBounds(offset, 0);
+            }
+        }
+    }
+};
+
+void SceneBinary::Initialize() {
+    enabled = EngineUtils::GetEnvVariable("SCENE_CACHE") != "off";
+}
+
+std::filesystem::path SceneBinary::BinaryPath(const std::string& scene_name) {
+    return std::filesystem::current_path() / ".cache" / "scenes" / (scene_name + ".sceneb");
+}
+
+bool SceneBinary::Load(const std::string& scene_name, std::vector<Actor*>& out) {
+    if(!enabled) {
+        return false;
+    }
+    MappedFile file;
+    if(!file.Open(BinaryPath(scene_name))) {
+        return false;
+    }
+    SceneLoader loader(file.data, file.size);
+    if(!loader.ok || !loader.Fresh() || !loader.Validate()) {
+        return false;
+    }
+    for(uint32_t i = 0; i < loader.header.actor_count; ++i) {
+        uint32_t offset;
+        std::memcpy(&offset, file.data + loader.header.actors_offset + i * 4, 4);
+        out.push_back(new Actor(loader.BuildActor(offset)));
+        n_actors++;
+    }
+    return true;
+}
+
+bool SceneBinary::Compile(const std::string& scene_name, rapidjson::Value& scene) {
+    if(!enabled || !scene.IsObject() || !scene.HasMember("actors")) {
+        return false;
+    }
+    SceneCompiler compiler;
+    compiler.AddDependency(resources / "scenes" / (scene_name + ".scene"));
+    for (auto& a : scene["actors"].GetArray()) {
+        compiler.actors.push_back(compiler.CompileActor(a));
+    }
+    return compiler.ok && compiler.Write(BinaryPath(scene_name));
+}
+
+int SceneBinary::CompileAll() {
+    int compiled = 0;
+    std::error_code ec;
+    for(const auto& entry : std::filesystem::directory_iterator(resources / "scenes", ec)) {
+        if(entry.path().extension() != ".scene") {
+            continue;
+        }
+        std::string scene_name = entry.path().stem().string();
+        ScratchJsonDocument scene;
+        EngineUtils::ReadJsonFile(entry.path().generic_string(), scene);
+        if(Compile(scene_name, scene)) {
+            ++compiled;
+        } else {
+            std::cout << "scene " << scene_name << " was not compiled" << std::endl;
+        }
+    }
+    return compiled;
+}
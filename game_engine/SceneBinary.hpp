@@ -0,0 +1,38 @@
+//
+//  SceneBinary.hpp
+//  game_engine
+//
+//  Created by Jasmine Li on 4/28/24.
+//
+
+#ifndef SceneBinary_hpp
+#define SceneBinary_hpp
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "rapidjson/document.h"
+
+class Actor;
+
+// Compiled scenes. A .scene and every template it pulls in are flattened into
+// one binary with interned strings, typed override values and a component type
+// table, then memory-mapped on load so actors are built without touching JSON.
+// Files live in .cache/scenes and go stale when any source's size or mtime
+// changes; stale or missing scenes load from JSON and are recompiled.
+// Set SCENE_CACHE=off to bypass.
+class SceneBinary {
+public:
+    static void Initialize();
+    static bool Load(const std::string& scene_name, std::vector<Actor*>& out);
+    static bool Compile(const std::string& scene_name, rapidjson::Value& scene);
+    static int CompileAll();
+
+private:
+    static inline bool enabled = true;
+
+    static std::filesystem::path BinaryPath(const std::string& scene_name);
+};
+
+#endif /* SceneBinary_hpp */
@@ -14,6 +14,15 @@
 #include "lua.hpp"
 #include "LuaBridge.h"
 #include "Rigidbody.hpp"
+#include "ScriptCache.hpp"
+#include "Coroutines.hpp"
+#include "SceneBinary.hpp"
+#include "ActorPool.hpp"
+#include "AsyncScene.hpp"
+#include "SceneStream.hpp"
+#include "AssetManifest.hpp"
+#include "TextureCache.hpp"
+#include "Animation.hpp"
 
 // Camera
 int w;
@@ -49,12 +58,14 @@ void LoadInitialScene() {
     // Check for resources directory
     resources = std::filesystem::current_path() / "resources";
     if (!std::filesystem::exists(resources)) {
+        Logger::Flush();
         std::cout << "error: resources/ missing";
         exit(0);
     }
     
     // Check for resources/game.config
     if(!std::filesystem::exists(resources/"game.config")) {
+        Logger::Flush();
         std::cout << "error: resources/game.config missing";
         exit(0);
     }
@@ -65,6 +76,7 @@ void LoadInitialScene() {
     if(config.HasMember("initial_scene")) {
         std::string scene_name = config["initial_scene"].GetString();
     } else {
+        Logger::Flush();
         std::cout << "error: initial_scene unspecified";
         exit(0);
     }
@@ -94,7 +106,7 @@ void LoadInitialScene() {
     
     // Rendering config
     if(std::filesystem::exists(resources/"rendering.config")) {
-        rapidjson::Document rendering;
+        ScratchJsonDocument rendering;
         EngineUtils::ReadJsonFile((resources/"rendering.config").generic_string(), rendering);
         if(rendering.HasMember("x_resolution")) {
             Camera::resolution.x = rendering["x_resolution"].GetInt();
@@ -164,7 +176,7 @@ Actor CreateActor(rapidjson::Value& a) {
                     // Add to actor
                     new_actor.components[c.name.GetString()] = Component(c.name.GetString(), type, component_instance);
                 }
-                else if(ComponentDB::component_tables.find(type) != ComponentDB::component_tables.end()) { // Component exists
+                else if(ComponentDB::HasComponentType(type)) { // Component exists
                     // Create instance of component
                     std::shared_ptr<luabridge::LuaRef> component_instance = ComponentDB::CreateComponentInstance(c.name.GetString(), type);
                     ComponentDB::OverrideComponentInstance(component_instance, c.value);
@@ -172,6 +184,7 @@ Actor CreateActor(rapidjson::Value& a) {
                     // Add to actor
                     new_actor.components[c.name.GetString()] = Component(c.name.GetString(), type, component_instance);
                 } else {
+                    Logger::Flush();
                     std::cout << "error: failed to locate component " << c.value["type"].GetString();
                     exit(0);
                 }
@@ -209,13 +222,14 @@ Actor CreateActor(rapidjson::Value& a) {
                     // Add to actor
                     new_actor.components[c.name.GetString()] = Component(c.name.GetString(), type, component_instance);
                 }
-                else if(ComponentDB::component_tables.find(type) != ComponentDB::component_tables.end()) { // Component exists
+                else if(ComponentDB::HasComponentType(type)) { // Component exists
                     std::shared_ptr<luabridge::LuaRef> component_instance = ComponentDB::CreateComponentInstance(c.name.GetString(), type);
                     ComponentDB::OverrideComponentInstance(component_instance, c.value);
 
                     // Add to actor
                     new_actor.components[c.name.GetString()] = Component(c.name.GetString(), type, component_instance);
                 } else {
+                    Logger::Flush();
                     std::cout << "error: failed to locate component " << type;
                     exit(0);
                 }
@@ -237,37 +251,113 @@ void Scene::Load(std::string scene_name) {
         load_new = true;
     }
     else {
+        Logger::Flush();
         std::cout << "error: scene " << scene_name << " is missing";
         exit(0);
     }
 }
 
 void Scene::LoadScene(std::string scene_name) {
+    // A synchronous load wins over one still in flight
+    AsyncScene::Cancel();
+    UnloadActors();
+    // Compiled scenes skip JSON entirely; otherwise load JSON and compile for next time
+    if(!SceneBinary::Load(scene_name, actors)) {
+        ScratchJsonDocument scene;
+        EngineUtils::ReadJsonFile((resources / "scenes" / (scene_name + ".scene")).generic_string(), scene);
+        
+        // Initialize actors
+        for (auto& a : scene["actors"].GetArray()) {
+            actors.push_back(new Actor(CreateActor(a)));
+            n_actors++;
+        }
+        SceneBinary::Compile(scene_name, scene);
+    }
+    FinishLoad(scene_name);
+}
+
+void Scene::UnloadActors() {
     std::vector<Actor*> actors_temp;
     for(auto& a : actors) {
         if(a->donotdestroy) {
             actors_temp.push_back(a);
         } else {
+            Coroutines::CancelAll(a);
+            ReleaseAnimations(a);
             delete a;
         }
     }
     actors = actors_temp;
     n_actors = actors.size();
+    ActorPool::Clear();
+    SceneStream::Reset();
     load_new = false;
-    rapidjson::Document scene;
-    scene.SetNull();
-    EngineUtils::ReadJsonFile((resources / "scenes" / (scene_name + ".scene")).generic_string(), scene);
-    
-    // Initialize actors
-    for (auto& a : scene["actors"].GetArray()) {
-        actors.push_back(new Actor(CreateActor(a)));
-        n_actors++;
+    Physics::ResetWorld(actors);
+}
+
+// Unloaded actors skip OnDestroy, so their shared animation models are released here
+void Scene::ReleaseAnimations(Actor* actor) {
+    for(auto& c : actor->components) {
+        if(c.second.type == "Animation") {
+            c.second.componentRef->cast<AnimationComponent*>()->OnDestroy();
+        }
     }
+}
+
+void Scene::FinishLoad(const std::string& scene_name) {
     for (Actor* actor : actors) {
         for(auto& c : actor->components) {
             actor->InjectConvenienceReferences(c.second.componentRef);
         }
     }
+    // Textures the old scene held are released first so shared ones carry over
+    TextureCache::SetScene(scene_name);
+    AssetManifest::Prefetch(scene_name);
+    TextureCache::Trim();
+    // Persist any scripts compiled for this scene
+    ScriptCache::Save();
+    ScriptCache::Report();
+}
+
+// Collect component types used by a scene's actors and their templates
+static void CollectComponentTypes(rapidjson::Value& actor, std::unordered_set<std::string>& types, std::unordered_set<std::string>& visited_templates) {
+    if(actor.HasMember("template")) {
+        std::string template_name = actor["template"].GetString();
+        std::filesystem::path template_path = resources / "actor_templates" / (template_name + ".template");
+        if(visited_templates.insert(template_name).second && std::filesystem::exists(template_path)) {
+            ScratchJsonDocument template_doc;
+            EngineUtils::ReadJsonFile(template_path.generic_string(), template_doc);
+            CollectComponentTypes(template_doc, types, visited_templates);
+        }
+    }
+    if(actor.HasMember("components")) {
+        for (auto& c : actor["components"].GetObject()) {
+            if(c.value.HasMember("type")) {
+                types.insert(c.value["type"].GetString());
+            }
+        }
+    }
+}
+
+void Scene::Prefetch(std::string scene_name) {
+    std::filesystem::path scene_path = resources / "scenes" / (scene_name + ".scene");
+    if (!std::filesystem::exists(scene_path)) {
+        Logger::Flush();
+        std::cout << "error: scene " << scene_name << " is missing";
+        exit(0);
+    }
+    ScratchJsonDocument scene;
+    EngineUtils::ReadJsonFile(scene_path.generic_string(), scene);
+    std::unordered_set<std::string> types;
+    std::unordered_set<std::string> visited_templates;
+    for (auto& a : scene["actors"].GetArray()) {
+        CollectComponentTypes(a, types, visited_templates);
+    }
+    for(const std::string& type : types) {
+        if(ComponentDB::HasComponentType(type)) {
+            ComponentDB::GetComponentTable(type);
+        }
+    }
 }
 
 std::string Scene::GetCurrent() {
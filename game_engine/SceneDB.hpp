@@ -63,10 +63,14 @@ public:
     static inline std::string current_scene;
     static inline bool load_new = false;
     static void LoadScene(std::string scene_name);
+    static void UnloadActors();
+    static void FinishLoad(const std::string& scene_name);
+    static void ReleaseAnimations(Actor* actor);
     
     static void Load(std::string scene_name);
     static std::string GetCurrent();
     static void DontDestroy(Actor* actor);
+    static void Prefetch(std::string scene_name);
     
     static inline SDL_Window* window;
     static inline SDL_Renderer* renderer;
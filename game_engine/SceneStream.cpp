@@ -0,0 +1,311 @@
+//
+//  SceneStream.cpp
+//  game_engine
+//
+//  Created by Jasmine Li on 5/1/24.
+//
+
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "SceneStream.hpp"
+#include "SceneDB.hpp"
+#include "ImageDB.hpp"
+#include "TextureCache.hpp"
+
+// Actors torn down per scan of the actor list
+static const int destroy_batch = 16;
+
+void SceneStream::Initialize() {
+    if(config.HasMember("stream_chunk_size")) {
+        chunk_size = config["stream_chunk_size"].GetFloat();
+    }
+    if(config.HasMember("stream_radius")) {
+        radius = config["stream_radius"].GetInt();
+    }
+    if(config.HasMember("stream_budget_ms")) {
+        budget_ms = config["stream_budget_ms"].GetFloat();
+    }
+    std::atexit(Shutdown);
+}
+
+void SceneStream::Stream(std::string world_name) {
+    if (!std::filesystem::is_directory(resources / "scenes" / world_name)) {
+        Logger::Flush();
+        std::cout << "error: scene " << world_name << " is missing";
+        exit(0);
+    }
+    if(world_name == world) {
+        return;
+    }
+    Stop();
+    world = world_name;
+}
+
+void SceneStream::Stop() {
+    for(auto& [cell, chunk] : chunks) {
+        chunk.state = ChunkState::Unloading;
+        chunk.doc.reset();
+    }
+    world.clear();
+    missing.clear();
+}
+
+int SceneStream::GetLoadedChunks() {
+    int loaded = 0;
+    for(auto& [cell, chunk] : chunks) {
+        if(chunk.state == ChunkState::Loaded) {
+            ++loaded;
+        }
+    }
+    return loaded;
+}
+
+void SceneStream::Update() {
+    if(world.empty() && chunks.empty() && !reader.joinable()) {
+        return;
+    }
+    if(!world.empty()) {
+        Request();
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::duration<float, std::milli> elapsed;
+    do {
+        if(!Step()) {
+            return;
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while(elapsed.count() < budget_ms);
+}
+
+// Queue chunks around the camera and drop the ones left behind
+void SceneStream::Request() {
+    std::pair<int, int> cell = {static_cast<int>(std::floor(Camera::camera_pos.x / chunk_size)), static_cast<int>(std::floor(Camera::camera_pos.y / chunk_size))};
+    if(cell != camera_chunk) {
+        camera_chunk = cell;
+        missing.clear();
+    }
+    for(int x = camera_chunk.first - radius; x <= camera_chunk.first + radius; ++x) {
+        for(int y = camera_chunk.second - radius; y <= camera_chunk.second + radius; ++y) {
+            std::pair<int, int> key = {x, y};
+            if(chunks.find(key) != chunks.end() || missing.find(key) != missing.end()) {
+                continue;
+            }
+            std::string scene_name = world + "/" + std::to_string(x) + "_" + std::to_string(y);
+            if(!std::filesystem::exists(resources / "scenes" / (scene_name + ".scene"))) {
+                missing.insert(key);
+                continue;
+            }
+            chunks[key].scene_name = scene_name;
+        }
+    }
+    // One chunk of slack so walking along a border doesn't thrash
+    for(auto& [key, chunk] : chunks) {
+        int distance = std::max(std::abs(key.first - camera_chunk.first), std::abs(key.second - camera_chunk.second));
+        if(chunk.state != ChunkState::Unloading && distance > radius + 1) {
+            chunk.state = ChunkState::Unloading;
+            chunk.doc.reset();
+        }
+    }
+}
+
+// Collects a finished read and starts the nearest unread chunk
+void SceneStream::Schedule() {
+    if(reader.joinable()) {
+        if(!read_done.load(std::memory_order_acquire)) {
+            return;
+        }
+        FinishRead();
+    }
+    auto unread = chunks.end();
+    int unread_distance = 0;
+    for(auto it = chunks.begin(); it != chunks.end(); ++it) {
+        if(it->second.state != ChunkState::Loading || it->second.doc) {
+            continue;
+        }
+        int distance = std::max(std::abs(it->first.first - camera_chunk.first), std::abs(it->first.second - camera_chunk.second));
+        if(unread == chunks.end() || distance < unread_distance) {
+            unread = it;
+            unread_distance = distance;
+        }
+    }
+    if(unread == chunks.end()) {
+        return;
+    }
+    reading_cell = unread->first;
+    reading_scene = unread->second.scene_name;
+    known_images.clear();
+    for(const std::string& image : TextureCache::GetNames()) {
+        known_images.insert(image);
+    }
+    read_done = false;
+    reader = std::thread(Read);
+}
+
+// Worker side; errors are reported, and the process exits, from the main thread
+void SceneStream::Read() {
+    read_doc = std::make_unique<rapidjson::Document>();
+    std::string path = (resources / "scenes" / (reading_scene + ".scene")).generic_string();
+    if(!EngineUtils::ParseJsonFile(path, *read_doc)) {
+        error = EngineUtils::JsonError(path, *read_doc);
+        read_done.store(true, std::memory_order_release);
+        return;
+    }
+    // Images named by component fields
+    std::set<std::string> names;
+    for (auto& a : (*read_doc)["actors"].GetArray()) {
+        if(!a.HasMember("components")) {
+            continue;
+        }
+        for (auto& c : a["components"].GetObject()) {
+            for (auto& field : c.value.GetObject()) {
+                if(field.value.IsString() && field.value.GetStringLength() > 0 && std::filesystem::exists(resources / "images" / (std::string(field.value.GetString()) + ".png"))) {
+                    names.insert(field.value.GetString());
+                }
+            }
+        }
+    }
+    for(const std::string& name : names) {
+        SDL_Surface* surface = nullptr;
+        if(known_images.find(name) == known_images.end()) {
+            surface = IMG_Load((resources / "images" / (name + ".png")).string().c_str());
+        }
+        read_images.push_back({name, surface});
+    }
+    read_done.store(true, std::memory_order_release);
+}
+
+void SceneStream::FinishRead() {
+    reader.join();
+    if(!error.empty()) {
+        Logger::Flush();
+        std::cout << error << std::endl;
+        exit(0);
+    }
+    // The chunk may have been dropped, or the world switched, while it was read
+    auto it = chunks.find(reading_cell);
+    if(it != chunks.end() && it->second.state == ChunkState::Loading && it->second.scene_name == reading_scene) {
+        it->second.doc = std::move(read_doc);
+        it->second.images = std::move(read_images);
+    } else {
+        FreeImages(read_images);
+    }
+    read_doc.reset();
+    read_images.clear();
+}
+
+// Unloading goes first so memory is freed before more is taken
+bool SceneStream::Step() {
+    Schedule();
+    for(auto it = chunks.begin(); it != chunks.end(); ++it) {
+        if(it->second.state != ChunkState::Unloading) {
+            continue;
+        }
+        if(!UnloadStep(it->second)) {
+            ReleaseTextures(it->second);
+            chunks.erase(it);
+        }
+        return true;
+    }
+    Chunk* nearest = nullptr;
+    int nearest_distance = 0;
+    for(auto& [key, chunk] : chunks) {
+        if(chunk.state != ChunkState::Loading || !chunk.doc) {
+            continue;
+        }
+        int distance = std::max(std::abs(key.first - camera_chunk.first), std::abs(key.second - camera_chunk.second));
+        if(nearest == nullptr || distance < nearest_distance) {
+            nearest = &chunk;
+            nearest_distance = distance;
+        }
+    }
+    if(nearest == nullptr) {
+        return false;
+    }
+    LoadStep(*nearest);
+    return true;
+}
+
+// Main-thread side of loading: one texture upload or one actor per call
+bool SceneStream::LoadStep(Chunk& chunk) {
+    if(chunk.next_image < chunk.images.size()) {
+        DecodedImage& image = chunk.images[chunk.next_image++];
+        if(!TextureCache::Reference(image.name, chunk.scene_name)) {
+            // No surface means it was cached when the chunk was read, but has been evicted since
+            SDL_Texture* texture = image.surface != nullptr ? SDL_CreateTextureFromSurface(Scene::renderer, image.surface) : IMG_LoadTexture(Scene::renderer, (resources / "images" / (image.name + ".png")).string().c_str());
+            TextureCache::Insert(image.name, texture, chunk.scene_name);
+        }
+        if(image.surface != nullptr) {
+            SDL_FreeSurface(image.surface);
+            image.surface = nullptr;
+        }
+        return true;
+    }
+    rapidjson::Value& chunk_actors = (*chunk.doc)["actors"];
+    if(chunk.next_actor < chunk_actors.Size()) {
+        Actor* actor = new Actor(CreateActor(chunk_actors[static_cast<rapidjson::SizeType>(chunk.next_actor++)]));
+        actor->actor_id = n_actors++;
+        actor->stream_chunk = chunk.scene_name;
+        for(auto& c : actor->components) {
+            actor->InjectConvenienceReferences(c.second.componentRef);
+        }
+        actors.push_back(actor);
+        return true;
+    }
+    chunk.state = ChunkState::Loaded;
+    chunk.doc.reset();
+    chunk.images.clear();
+    return false;
+}
+
+// Destroys a batch of the chunk's actors; false once none are left
+bool SceneStream::UnloadStep(Chunk& chunk) {
+    int destroyed = 0;
+    for(Actor* actor : actors) {
+        if(actor->stream_chunk != chunk.scene_name) {
+            continue;
+        }
+        actor->stream_chunk.clear();
+        Actor::Destroy(actor);
+        if(++destroyed == destroy_batch) {
+            break;
+        }
+    }
+    return destroyed > 0;
+}
+
+void SceneStream::ReleaseTextures(Chunk& chunk) {
+    TextureCache::ReleaseScene(chunk.scene_name);
+    FreeImages(chunk.images);
+    chunk.next_image = 0;
+}
+
+void SceneStream::FreeImages(std::vector<DecodedImage>& images) {
+    for(DecodedImage& image : images) {
+        if(image.surface != nullptr) {
+            SDL_FreeSurface(image.surface);
+        }
+    }
+    images.clear();
+}
+
+// A full scene load already deleted the streamed actors
+void SceneStream::Reset() {
+    for(Actor* actor : actors) {
+        actor->stream_chunk.clear();
+    }
+    for(auto& [key, chunk] : chunks) {
+        ReleaseTextures(chunk);
+    }
+    chunks.clear();
+    world.clear();
+    missing.clear();
+}
+
+void SceneStream::Shutdown() {
+    // exit() can come from the main thread while a chunk is still being read
+    if(reader.joinable()) {
+        reader.join();
+    }
+}
@@ -0,0 +1,93 @@
+//
+//  SceneStream.hpp
+//  game_engine
+//
+//  Created by Jasmine Li on 5/1/24.
+//
+
+#ifndef SceneStream_hpp
+#define SceneStream_hpp
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include "rapidjson/document.h"
+#include "SDL2/SDL.h"
+
+// Additive world streaming. Scene.Stream(world) treats
+// scenes/<world>/<x>_<y>.scene as a grid of stream_chunk_size world units and
+// keeps the chunks within stream_radius of the camera loaded. A worker thread
+// parses each chunk and decodes its images, nearest first; the main thread then
+// uploads textures and builds actors a few at a time within stream_budget_ms.
+// Chunks are torn down the same way, and drop once they are more than one chunk
+// outside the radius, so memory
+// follows the camera rather than the size of the world. A chunk's textures
+// are referenced in TextureCache under the chunk's scene name.
+class SceneStream {
+public:
+    static void Initialize();
+    static void Update();
+    static void Reset();
+
+    static void Stream(std::string world_name);
+    static void Stop();
+    static int GetLoadedChunks();
+    static void Shutdown();
+
+private:
+    enum class ChunkState { Loading, Loaded, Unloading };
+
+    struct DecodedImage {
+        std::string name;
+        SDL_Surface* surface = nullptr; // null if it was already cached when read
+    };
+
+    struct Chunk {
+        std::string scene_name;
+        ChunkState state = ChunkState::Loading;
+        std::unique_ptr<rapidjson::Document> doc; // set once the reader is done with it
+        std::vector<DecodedImage> images;
+        size_t next_image = 0;
+        size_t next_actor = 0;
+    };
+
+    static inline std::string world;
+    static inline float chunk_size = 10.0f;
+    static inline int radius = 1;
+    static inline float budget_ms = 2.0f;
+
+    static inline std::map<std::pair<int, int>, Chunk> chunks;
+    static inline std::pair<int, int> camera_chunk = {0, 0};
+    static inline std::set<std::pair<int, int>> missing; // cells with no file near camera_chunk
+
+    // One chunk is read at a time
+    static inline std::thread reader;
+    static inline std::atomic<bool> read_done = false;
+    static inline std::pair<int, int> reading_cell = {0, 0};
+    static inline std::string reading_scene;
+    static inline std::unordered_set<std::string> known_images;
+
+    // Filled by the reader, taken by the main thread once read_done is set
+    static inline std::unique_ptr<rapidjson::Document> read_doc;
+    static inline std::vector<DecodedImage> read_images;
+    static inline std::string error;
+
+    static void Request();
+    static void Schedule();
+    static void Read();
+    static void FinishRead();
+    static bool Step();
+    static bool LoadStep(Chunk& chunk);
+    static bool UnloadStep(Chunk& chunk);
+    static void ReleaseTextures(Chunk& chunk);
+    static void FreeImages(std::vector<DecodedImage>& images);
+};
+
+#endif /* SceneStream_hpp */
@@ -0,0 +1,197 @@
+//
+//  ScriptCache.cpp
+//  game_engine
+//
+//  Created by Jasmine Li on 4/24/24.
+//
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "ScriptCache.hpp"
+#include "EngineUtils.h"
+
+static const char pack_magic[4] = {'L', 'B', 'C', '1'};
+
+template <typename T>
+static bool ReadValue(std::ifstream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+template <typename T>
+static void WriteValue(std::ofstream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// end is the file size; a corrupt length must not allocate past it
+static bool ReadString(std::ifstream& in, std::string& value, std::streamoff end) {
+    uint32_t length = 0;
+    if(!ReadValue(in, length) || static_cast<std::streamoff>(length) > end - static_cast<std::streamoff>(in.tellg())) {
+        return false;
+    }
+    value.resize(length);
+    return static_cast<bool>(in.read(value.data(), length));
+}
+
+static void WriteString(std::ofstream& out, const std::string& value) {
+    WriteValue(out, static_cast<uint32_t>(value.size()));
+    out.write(value.data(), value.size());
+}
+
+static int DumpWriter(lua_State*, const void* p, size_t size, void* ud) {
+    static_cast<std::string*>(ud)->append(static_cast<const char*>(p), size);
+    return 0;
+}
+
+void ScriptCache::Load() {
+    enabled = EngineUtils::GetEnvVariable("SCRIPT_CACHE") != "off";
+    pack_path = std::filesystem::current_path() / ".cache" / "component_types.luac";
+    if(!enabled) {
+        return;
+    }
+    std::ifstream in(pack_path, std::ios::binary | std::ios::ate);
+    if(!in) {
+        return;
+    }
+    std::streamoff end = in.tellg();
+    in.seekg(0);
+    // Any mismatch means an old or foreign pack; start cold
+    char magic[4];
+    int32_t version = 0;
+    uint32_t count = 0;
+    if(!in.read(magic, 4) || std::memcmp(magic, pack_magic, 4) != 0 || !ReadValue(in, version) || version != LUA_VERSION_NUM || !ReadValue(in, count)) {
+        return;
+    }
+    for(uint32_t i = 0; i < count; ++i) {
+        std::string path;
+        Entry entry;
+        if(!ReadString(in, path, end) || !ReadValue(in, entry.size) || !ReadValue(in, entry.mtime) || !ReadString(in, entry.bytecode, end)) {
+            entries.clear();
+            return;
+        }
+        entries[path] = std::move(entry);
+    }
+}
+
+void ScriptCache::Save() {
+    if(!enabled || !dirty) {
+        return;
+    }
+    // Drop scripts that were deleted
+    for(auto it = entries.begin(); it != entries.end();) {
+        if(std::filesystem::exists(it->first)) {
+            ++it;
+        } else {
+            it = entries.erase(it);
+        }
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(pack_path.parent_path(), ec);
+    // Write beside and rename so a crash never leaves a torn pack
+    std::filesystem::path tmp_path = pack_path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if(!out) {
+            return;
+        }
+        out.write(pack_magic, 4);
+        WriteValue(out, static_cast<int32_t>(LUA_VERSION_NUM));
+        WriteValue(out, static_cast<uint32_t>(entries.size()));
+        for(const auto& [path, entry] : entries) {
+            WriteString(out, path);
+            WriteValue(out, entry.size);
+            WriteValue(out, entry.mtime);
+            WriteString(out, entry.bytecode);
+        }
+    }
+    std::filesystem::rename(tmp_path, pack_path, ec);
+    dirty = false;
+}
+
+int ScriptCache::LoadFile(lua_State* lua_state, const std::filesystem::path& path) {
+    auto start = std::chrono::steady_clock::now();
+    std::string key = path.generic_string();
+    std::string chunk_name = "@" + key;
+
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    bool stamped = enabled && EngineUtils::GetFileStamp(path, size, mtime);
+
+    int status = LUA_ERRFILE;
+    auto it = entries.find(key);
+    if(stamped && it != entries.end() && it->second.size == size && it->second.mtime == mtime) {
+        status = luaL_loadbufferx(lua_state, it->second.bytecode.data(), it->second.bytecode.size(), chunk_name.c_str(), "b");
+        if(status == LUA_OK) {
+            ++hits;
+        } else {
+            lua_pop(lua_state, 1);
+        }
+    }
+    if(status != LUA_OK) {
+        status = luaL_loadfile(lua_state, key.c_str());
+        if(status == LUA_OK && stamped) {
+            Entry& entry = entries[key];
+            entry.size = size;
+            entry.mtime = mtime;
+            entry.bytecode.clear();
+            lua_dump(lua_state, DumpWriter, &entry.bytecode, 0);
+            dirty = true;
+        }
+        ++misses;
+    }
+    if(status == LUA_OK) {
+        status = lua_pcall(lua_state, 0, LUA_MULTRET, 0);
+    }
+    load_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return status;
+}
+
+// Compiles stale or missing entries in a private state so LoadFile only has to
+// run them. Safe off the main thread as long as nothing else touches the cache.
+int ScriptCache::Precompile(const std::filesystem::path& directory) {
+    if(!enabled) {
+        return 0;
+    }
+    int compiled = 0;
+    lua_State* compiler = luaL_newstate();
+    std::error_code ec;
+    for(const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        if(!entry.is_regular_file() || entry.path().extension() != ".lua") {
+            continue;
+        }
+        // Same key ComponentDB loads the script under
+        std::string key = (directory / entry.path().filename()).generic_string();
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        if(!EngineUtils::GetFileStamp(key, size, mtime)) {
+            continue;
+        }
+        auto it = entries.find(key);
+        if(it != entries.end() && it->second.size == size && it->second.mtime == mtime) {
+            continue;
+        }
+        // Syntax errors are left for LoadFile to report
+        if(luaL_loadfile(compiler, key.c_str()) == LUA_OK) {
+            Entry& cached = entries[key];
+            cached.size = size;
+            cached.mtime = mtime;
+            cached.bytecode.clear();
+            lua_dump(compiler, DumpWriter, &cached.bytecode, 0);
+            dirty = true;
+            ++compiled;
+        }
+        lua_settop(compiler, 0);
+    }
+    lua_close(compiler);
+    return compiled;
+}
+
+void ScriptCache::Report() {
+    if(EngineUtils::GetEnvVariable("SCRIPT_CACHE_REPORT").empty()) {
+        return;
+    }
+    Logger::Flush();
+    std::cout << "script cache: " << hits << " hits " << misses << " misses " << load_ms << " ms" << std::endl;
+}
@@ -0,0 +1,46 @@
+//
+//  ScriptCache.hpp
+//  game_engine
+//
+//  Created by Jasmine Li on 4/24/24.
+//
+
+#ifndef ScriptCache_hpp
+#define ScriptCache_hpp
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+#include "lua.hpp"
+
+// Keeps compiled Lua chunks in one packed file so unchanged scripts skip the
+// parser on launch. Entries are keyed by path and go stale when the source's
+// size or mtime changes. Set SCRIPT_CACHE=off to bypass, SCRIPT_CACHE_REPORT
+// to print hit/miss counts and load time.
+class ScriptCache {
+public:
+    static void Load();
+    static void Save();
+    static int LoadFile(lua_State* lua_state, const std::filesystem::path& path);
+    static int Precompile(const std::filesystem::path& directory);
+    static void Report();
+
+private:
+    struct Entry {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        std::string bytecode;
+    };
+
+    static inline std::unordered_map<std::string, Entry> entries;
+    static inline std::filesystem::path pack_path;
+    static inline bool enabled = true;
+    static inline bool dirty = false;
+    static inline int hits = 0;
+    static inline int misses = 0;
+    static inline double load_ms = 0.0;
+};
+
+#endif /* ScriptCache_hpp */
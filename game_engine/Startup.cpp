@@ -0,0 +1,287 @@
+//
+//  Startup.cpp
+//  game_engine
+//
+//  Created by Jasmine Li on 5/2/24.
+//
+
+#include <thread>
+#include <algorithm>
+#include <iomanip>
+#include <unordered_set>
+#include "Startup.hpp"
+#include "SceneDB.hpp"
+#include "ComponentDB.hpp"
+#include "TemplateDB.h"
+#include "ImageDB.hpp"
+#include "AudioDB.hpp"
+#include "TextDB.hpp"
+#include "Region.hpp"
+#include "LuaGC.hpp"
+#include "Profiler.hpp"
+#include "Logger.hpp"
+#include "AsyncScene.hpp"
+#include "SceneStream.hpp"
+#include "SceneBinary.hpp"
+#include "ScriptCache.hpp"
+#include "AssetManifest.hpp"
+#include "TextureCache.hpp"
+#include "Animation.hpp"
+
+void Startup::Run(bool trace) {
+    int config_task = Add("config", Affinity::Main, {}, [] {
+        LoadInitialScene();
+        SceneBinary::Initialize();
+        if (game_start_message != "") {
+            std::cout << game_start_message << std::endl;
+        }
+    });
+    // Config errors exit(), so nothing else starts until it has been read
+    int lua = Add("lua", Affinity::Worker, {config_task}, [] { ComponentDB::Initialize(); });
+    int scripts = Add("scripts", Affinity::Worker, {lua}, [] { ScriptCache::Precompile("resources/component_types"); });
+    int parse = Add("templates", Affinity::Worker, {config_task}, ParseTemplates);
+    int systems = Add("systems", Affinity::Main, {config_task, lua}, [] {
+        Region::Initialize();
+        Actor::InitializeSchedule();
+        LuaGC::Initialize();
+        Profiler::Initialize();
+        Logger::Initialize();
+        AsyncScene::Initialize();
+        SceneStream::Initialize();
+        AssetManifest::Initialize();
+        TextureCache::Initialize();
+        AnimationDB::Initialize();
+    });
+    int audio = Add("audio", Affinity::Main, {config_task}, [] { Audio::Initialize(); });
+    int window = Add("window", Affinity::Main, {config_task}, [] { Image::Initialize(); });
+    Add("text", Affinity::Main, {config_task}, [] { Text::Initialize(); });
+    int images = Add("decode images", Affinity::Worker, {parse}, DecodeImages);
+    int clips = Add("decode audio", Affinity::Worker, {parse, audio}, DecodeAudio);
+    int upload = Add("upload textures", Affinity::Main, {window, images}, [] {
+        for(auto& [name, surface] : surfaces) {
+            if(!TextureCache::Reference(name, config["initial_scene"].GetString())) {
+                TextureCache::Insert(name, SDL_CreateTextureFromSurface(Scene::renderer, surface), config["initial_scene"].GetString());
+            }
+            SDL_FreeSurface(surface);
+        }
+        surfaces.clear();
+    });
+    int add_clips = Add("add clips", Affinity::Main, {clips}, [] {
+        for(auto& [name, chunk] : chunks) {
+            Audio::AddClip(name, chunk);
+        }
+        chunks.clear();
+    });
+    // After the uploads so the manifest prefetch finds everything resident
+    Add("scene", Affinity::Main, {scripts, parse, systems, window, upload, add_clips}, [] {
+        Scene::Load(config["initial_scene"].GetString());
+        Scene::LoadScene(config["initial_scene"].GetString());
+    });
+
+    origin = std::chrono::steady_clock::now();
+    remaining = static_cast<int>(tasks.size());
+    int worker_count = std::clamp(static_cast<int>(std::thread::hardware_concurrency()) - 1, 1, 3);
+    std::vector<std::thread> workers;
+    for(int i = 1; i <= worker_count; ++i) {
+        workers.emplace_back(Work, Affinity::Worker, i);
+    }
+    Work(Affinity::Main, 0);
+    for(std::thread& worker : workers) {
+        worker.join();
+    }
+    // Reported here because worker threads must not exit()
+    if(!error.empty()) {
+        Logger::Flush();
+        std::cout << error << std::endl;
+        exit(0);
+    }
+    if(trace) {
+        PrintTrace();
+    }
+    tasks.clear();
+}
+
+int Startup::Add(const std::string& name, Affinity affinity, std::vector<int> deps, std::function<void()> run) {
+    Task task;
+    task.name = name;
+    task.affinity = affinity;
+    task.deps = std::move(deps);
+    task.run = std::move(run);
+    tasks.push_back(std::move(task));
+    return static_cast<int>(tasks.size()) - 1;
+}
+
+// Caller holds the mutex
+int Startup::NextReady(Affinity affinity) {
+    for(size_t i = 0; i < tasks.size(); ++i) {
+        Task& task = tasks[i];
+        if(task.started || task.affinity != affinity) {
+            continue;
+        }
+        bool ready = true;
+        for(int dep : task.deps) {
+            ready = ready && tasks[dep].done;
+        }
+        if(ready) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void Startup::Work(Affinity affinity, int thread) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true) {
+        if(!error.empty()) {
+            // Nothing new starts; the main thread waits out tasks already running
+            if(affinity == Affinity::Main) {
+                changed.wait(lock, [] { return running == 0; });
+            }
+            return;
+        }
+        bool pending = false;
+        for(const Task& task : tasks) {
+            pending = pending || (task.affinity == affinity && !task.started);
+        }
+        if(!pending) {
+            // The main thread also waits for the workers' last tasks
+            if(affinity == Affinity::Main && remaining > 0) {
+                changed.wait(lock);
+                continue;
+            }
+            return;
+        }
+        int next = NextReady(affinity);
+        if(next < 0) {
+            changed.wait(lock);
+            continue;
+        }
+        tasks[next].started = true;
+        ++running;
+        lock.unlock();
+        Execute(next, thread);
+        lock.lock();
+        tasks[next].done = true;
+        --running;
+        --remaining;
+        changed.notify_all();
+    }
+}
+
+void Startup::Execute(int index, int thread) {
+    Task& task = tasks[index];
+    task.thread = thread;
+    task.start_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - origin).count();
+    task.run();
+    task.end_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - origin).count();
+}
+
+void Startup::PrintTrace() {
+    double total = 0.0;
+    for(const Task& task : tasks) {
+        total = std::max(total, task.end_ms);
+    }
+    const int width = 40;
+    Logger::Flush();
+    std::cout << "startup trace (" << std::fixed << std::setprecision(2) << total << " ms)" << std::endl;
+    for(const Task& task : tasks) {
+        int from = total > 0.0 ? static_cast<int>(task.start_ms / total * width) : 0;
+        int to = total > 0.0 ? static_cast<int>(task.end_ms / total * width) : 0;
+        std::string bar = std::string(from, ' ') + std::string(std::max(to - from, 1), '#');
+        std::string thread = task.thread == 0 ? "main" : "worker " + std::to_string(task.thread);
+        std::cout << "  " << std::left << std::setw(16) << task.name << std::setw(10) << thread
+            << std::right << std::setw(9) << task.start_ms << std::setw(9) << task.end_ms << "  |" << std::left << std::setw(width) << bar << "|" << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
+
+void Startup::Fail(const std::string& message) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if(error.empty()) {
+        error = message;
+    }
+}
+
+// Every template, plus the first scene's image/audio names (component string
+// fields that name a file in images/ or audio/)
+void Startup::ParseTemplates() {
+    std::unordered_set<std::string> names;
+    auto collect = [&names](rapidjson::Value& actor) {
+        if(!actor.IsObject() || !actor.HasMember("components")) {
+            return;
+        }
+        for (auto& c : actor["components"].GetObject()) {
+            for (auto& field : c.value.GetObject()) {
+                if(field.value.IsString() && field.value.GetStringLength() > 0) {
+                    names.insert(field.value.GetString());
+                }
+            }
+        }
+    };
+
+    std::error_code ec;
+    for(const auto& entry : std::filesystem::directory_iterator(resources / "actor_templates", ec)) {
+        if(entry.path().extension() != ".template") {
+            continue;
+        }
+        std::unique_ptr<rapidjson::Document> doc = std::make_unique<rapidjson::Document>();
+        if(!EngineUtils::ParseJsonFile(entry.path().generic_string(), *doc)) {
+            Fail(EngineUtils::JsonError(entry.path().generic_string(), *doc));
+            return;
+        }
+        preloaded_templates[entry.path().stem().string()] = std::move(doc);
+    }
+    rapidjson::Document scene;
+    std::string scene_path = (resources / "scenes" / (std::string(config["initial_scene"].GetString()) + ".scene")).generic_string();
+    if(!EngineUtils::ParseJsonFile(scene_path, scene)) {
+        Fail(EngineUtils::JsonError(scene_path, scene));
+        return;
+    }
+    std::unordered_set<std::string> used_templates;
+    for (auto& a : scene["actors"].GetArray()) {
+        collect(a);
+        // Follow the template chain so inherited fields count too
+        std::string template_name = a.HasMember("template") ? a["template"].GetString() : "";
+        while(!template_name.empty() && used_templates.insert(template_name).second) {
+            auto doc = preloaded_templates.find(template_name);
+            if(doc == preloaded_templates.end()) {
+                break;
+            }
+            collect(*doc->second);
+            template_name = doc->second->HasMember("template") ? (*doc->second)["template"].GetString() : "";
+        }
+    }
+    std::vector<std::string> manifest_images;
+    std::vector<std::string> manifest_clips;
+    AssetManifest::ReadNames(config["initial_scene"].GetString(), manifest_images, manifest_clips);
+    names.insert(manifest_images.begin(), manifest_images.end());
+    names.insert(manifest_clips.begin(), manifest_clips.end());
+    for(const std::string& name : names) {
+        if(std::filesystem::exists(resources / "images" / (name + ".png"))) {
+            image_names.push_back(name);
+        }
+        if(std::filesystem::exists(resources / "audio" / (name + ".wav")) || std::filesystem::exists(resources / "audio" / (name + ".ogg"))) {
+            clip_names.push_back(name);
+        }
+    }
+}
+
+void Startup::DecodeImages() {
+    for(const std::string& name : image_names) {
+        SDL_Surface* surface = IMG_Load((resources / "images" / (name + ".png")).string().c_str());
+        if(surface != nullptr) {
+            surfaces.push_back({name, surface});
+        }
+    }
+}
+
+void Startup::DecodeAudio() {
+    for(const std::string& name : clip_names) {
+        std::filesystem::path wav = resources / "audio" / (name + ".wav");
+        std::filesystem::path path = std::filesystem::exists(wav) ? wav : resources / "audio" / (name + ".ogg");
+        Mix_Chunk* chunk = AudioHelper::Mix_LoadWAV498(path.string().c_str());
+        if(chunk != nullptr) {
+            chunks.push_back({name, chunk});
+        }
+    }
+}
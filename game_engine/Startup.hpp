@@ -0,0 +1,71 @@
+//
+//  Startup.hpp
+//  game_engine
+//
+//  Created by Jasmine Li on 5/2/24.
+//
+
+#ifndef Startup_hpp
+#define Startup_hpp
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include "SDL2/SDL.h"
+#include "SDL2_mixer/SDL_mixer.h"
+
+// Engine startup as a task graph. Lua setup, script compilation, template
+// parsing and first-scene asset decoding run on worker threads; SDL, systems
+// that read config and the first scene load stay on the main thread. A task
+// starts as soon as the tasks it names are done. --startup-trace prints when
+// each one ran and on which thread.
+class Startup {
+public:
+    static void Run(bool trace);
+
+private:
+    enum class Affinity { Main, Worker };
+
+    struct Task {
+        std::string name;
+        Affinity affinity;
+        std::vector<int> deps;
+        std::function<void()> run;
+        bool started = false;
+        bool done = false;
+        int thread = 0;
+        double start_ms = 0.0;
+        double end_ms = 0.0;
+    };
+
+    static inline std::vector<Task> tasks;
+    static inline int remaining = 0;
+    static inline int running = 0;
+    static inline std::string error; // first failure, reported by the main thread
+    static inline std::mutex mutex;
+    static inline std::condition_variable changed;
+    static inline std::chrono::steady_clock::time_point origin;
+
+    // Handed from the parsing task to the decoding ones
+    static inline std::vector<std::string> image_names;
+    static inline std::vector<std::string> clip_names;
+    static inline std::vector<std::pair<std::string, SDL_Surface*>> surfaces;
+    static inline std::vector<std::pair<std::string, Mix_Chunk*>> chunks;
+
+    static int Add(const std::string& name, Affinity affinity, std::vector<int> deps, std::function<void()> run);
+    static int NextReady(Affinity affinity);
+    static void Execute(int index, int thread);
+    static void Work(Affinity affinity, int thread);
+    static void PrintTrace();
+    static void Fail(const std::string& message);
+
+    static void ParseTemplates();
+    static void DecodeImages();
+    static void DecodeAudio();
+};
+
+#endif /* Startup_hpp */
@@ -3,21 +3,112 @@
 
 std::unordered_map<std::string, std::unique_ptr<rapidjson::Document>> templates;
 
+std::unordered_map<std::string, ActorPrototype> prototypes;
+
+std::unordered_map<std::string, std::unique_ptr<rapidjson::Document>> preloaded_templates;
+
+// Templates that inherit another template keep the JSON path
+static bool BuildPrototype(rapidjson::Document& doc, ActorPrototype& prototype) {
+    if(doc.HasMember("template")) {
+        return false;
+    }
+    prototype.name = doc.HasMember("name") ? doc["name"].GetString() : "";
+    prototype.has_components = doc.HasMember("components");
+    prototype.pool = doc.HasMember("pool") ? doc["pool"].GetInt() : 0;
+    if(!prototype.has_components) {
+        return true;
+    }
+    // Keys in map order, matching the lifecycle queues CreateActor builds
+    std::map<std::string, rapidjson::Value*> components;
+    for (auto& c : doc["components"].GetObject()) {
+        components[c.name.GetString()] = &c.value;
+    }
+    for (auto& [key, value] : components) {
+        ComponentPrototype component;
+        component.key = key;
+        component.type = (*value)["type"].GetString();
+        if(component.type == "Rigidbody" || component.type == "Animation") {
+            component.json = value;
+        } else {
+            ComponentDB::GetComponentTable(component.type);
+            // Fields only; the shared per-type metatable is attached per spawn
+            component.table = std::make_shared<luabridge::LuaRef>(luabridge::newTable(ComponentDB::GetLuaState()));
+            (*component.table)["key"] = key;
+            (*component.table)["type"] = component.type;
+            (*component.table)["enabled"] = true;
+            ComponentDB::OverrideComponentInstance(component.table, *value);
+            for(auto pair : luabridge::pairs(*component.table)) {
+                ++component.field_count;
+            }
+        }
+        prototype.components.push_back(std::move(component));
+    }
+    return true;
+}
+
+static Actor SpawnPrototype(const ActorPrototype& prototype) {
+    Actor new_actor(n_actors, prototype.name, "");
+    for(const ComponentPrototype& c : prototype.components) {
+        std::shared_ptr<luabridge::LuaRef> component_instance;
+        if(c.table) {
+            component_instance = ComponentDB::CloneComponentInstance(*c.table, c.type, c.field_count);
+        } else {
+            component_instance = c.type == "Rigidbody" ? ComponentDB::CreateRigidbody(c.key) : ComponentDB::CreateAnimation(c.key);
+            ComponentDB::OverrideComponentInstance(component_instance, *c.json);
+        }
+        new_actor.components[c.key] = Component(c.key, c.type, component_instance);
+    }
+    if(prototype.has_components) {
+        for(const ComponentPrototype& c : prototype.components) {
+            new_actor.onstart_queue.push_back(c.key);
+            new_actor.update_queue.push_back(c.key);
+            new_actor.lateupdate_queue.push_back(c.key);
+        }
+    }
+    return new_actor;
+}
+
+void InstallTemplate(const std::string& name, std::unique_ptr<rapidjson::Document> doc) {
+    if(templates.find(name) != templates.end()) {
+        return;
+    }
+    templates[name] = std::move(doc);
+    ActorPrototype new_prototype;
+    if(BuildPrototype(*templates[name], new_prototype)) {
+        prototypes.emplace(name, std::move(new_prototype));
+    }
+}
+
 Actor LoadActorFromTemplate(std::string name) {
+    auto prototype = prototypes.find(name);
+    if(prototype != prototypes.end()) {
+        return SpawnPrototype(prototype->second);
+    }
+    // Parsed ahead of time by the startup graph
+    auto preloaded = preloaded_templates.find(name);
+    if(preloaded != preloaded_templates.end()) {
+        InstallTemplate(name, std::move(preloaded->second));
+        preloaded_templates.erase(preloaded);
+        prototype = prototypes.find(name);
+        if(prototype != prototypes.end()) {
+            return SpawnPrototype(prototype->second);
+        }
+    }
     std::string path = (resources / "actor_templates" / (name + ".template")).generic_string();
 	if (!std::filesystem::exists(path)) {
+        Logger::Flush();
         std::cout << "error: template " << name << " is missing";
         exit(0);
     }
 	if (templates.find(name) == templates.end()) { // New template
 		std::unique_ptr<rapidjson::Document> temp = std::make_unique<rapidjson::Document>();
 		EngineUtils::ReadJsonFile(path, *temp);
+        InstallTemplate(name, std::move(temp));
         
-		Actor new_actor = CreateActor(*temp);
-        templates[name] = std::move(temp);
-		return new_actor;
-	}
-	else {
-		return CreateActor(*templates[name]);
+        prototype = prototypes.find(name);
+        if(prototype != prototypes.end()) {
+            return SpawnPrototype(prototype->second);
+        }
 	}
+    return CreateActor(*templates[name]);
 }
@@ -10,4 +10,28 @@
 
 extern std::unordered_map<std::string, std::unique_ptr<rapidjson::Document>> templates;
 
+// A template compiled once; spawning clones it instead of re-walking the JSON
+struct ComponentPrototype {
+    std::string key;
+    std::string type;
+    std::shared_ptr<luabridge::LuaRef> table; // Lua components: fields copied per spawn
+    int field_count = 0;
+    rapidjson::Value* json = nullptr; // Rigidbody/Animation: overrides re-applied per spawn
+};
+
+struct ActorPrototype {
+    std::string name;
+    bool has_components = false;
+    int pool = 0; // "pool": N keeps up to N destroyed actors for reuse
+    std::vector<ComponentPrototype> components;
+};
+
+extern std::unordered_map<std::string, ActorPrototype> prototypes;
+
+// Parsed but not yet installed; taken on first use
+extern std::unordered_map<std::string, std::unique_ptr<rapidjson::Document>> preloaded_templates;
+
+// Takes a template parsed elsewhere (e.g. on a loader thread); no-op if already loaded
+void InstallTemplate(const std::string& name, std::unique_ptr<rapidjson::Document> doc);
+
 Actor LoadActorFromTemplate(std::string name);
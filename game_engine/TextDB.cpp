@@ -7,32 +7,33 @@
 
 #include "TextDB.hpp"
 #include "ImageDB.hpp"
+#include "AssetManifest.hpp"
 
 void Text::Initialize() {
     TTF_Init();
 }
 
-void Text::Draw(std::string str_content, float x, float y, std::string font_name, int font_size, float r, float g, float b, float a) {
-    TTF_Font* font;
-    if(fonts.find(font_name) != fonts.end()) {
-        if(fonts[font_name].find(font_size) != fonts[font_name].end()) {
-            font = fonts[font_name][font_size];
-        } else {
-            std::filesystem::path path = resources/"fonts"/(font_name +".ttf");
-            if(!std::filesystem::exists(path)) {
-                std::cout << "error: font " + font_name + " missing";
-                exit(0);
-            }
-            font = TTF_OpenFont(path.string().c_str(), font_size);
-        }
-    } else {
-        std::filesystem::path path = resources/"fonts"/(font_name +".ttf");
-        if(!std::filesystem::exists(path)) {
-            std::cout << "error: font " + font_name + " missing";
-            exit(0);
-        }
-        font = TTF_OpenFont(path.string().c_str(), font_size);
+TTF_Font* Text::LoadFont(const std::string& font_name, int font_size) {
+    AssetManifest::Requested(AssetKind::Font, font_name, font_size);
+    auto& sizes = fonts[font_name];
+    auto loaded = sizes.find(font_size);
+    if(loaded != sizes.end()) {
+        return loaded->second;
+    }
+    std::filesystem::path path = resources/"fonts"/(font_name +".ttf");
+    if(!std::filesystem::exists(path)) {
+        Logger::Flush();
+        std::cout << "error: font " + font_name + " missing";
+        exit(0);
     }
+    AssetManifest::Loaded();
+    TTF_Font* font = TTF_OpenFont(path.string().c_str(), font_size);
+    sizes[font_size] = font;
+    return font;
+}
+
+void Text::Draw(std::string str_content, float x, float y, std::string font_name, int font_size, float r, float g, float b, float a) {
+    TTF_Font* font = LoadFont(font_name, font_size);
     SDL_Color color = {static_cast<Uint8>(r), static_cast<Uint8>(g), static_cast<Uint8>(b), static_cast<Uint8>(a)};
     SDL_Surface* surface = TTF_RenderText_Solid(font, str_content.c_str(), color);
     SDL_Texture* texture = SDL_CreateTextureFromSurface(Scene::renderer, surface);
@@ -20,6 +20,7 @@ private:
     static inline std::unordered_map<std::string, std::unordered_map<int, TTF_Font*>> fonts;
 public:
     static void Initialize();
+    static TTF_Font* LoadFont(const std::string& font_name, int font_size);
     static void Draw(std::string str_content, float x, float y, std::string font_name, int font_size, float r, float g, float b, float a);
     
 };
@@ -0,0 +1,209 @@
+//
+//  TextureCache.cpp
+//  game_engine
+//
+//  Created by Jasmine Li on 5/4/24.
+//
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include "TextureCache.hpp"
+#include "SceneDB.hpp"
+
+void TextureCache::Initialize() {
+    if(config.HasMember("texture_budget_mb")) {
+        budget = static_cast<size_t>(std::max(config["texture_budget_mb"].GetInt(), 0)) << 20;
+    }
+    std::atexit(Report);
+}
+
+SDL_Texture* TextureCache::Find(const std::string& name) {
+    auto entry = entries.find(name);
+    if(entry == entries.end()) {
+        ++misses;
+        return nullptr;
+    }
+    ++hits;
+    entry->second.last_used = ++clock;
+    // Whatever the current scene draws is held by it, even if a streamed or
+    // loading scene already holds it and releases it before present
+    AddReference(entry->second, scene);
+    return entry->second.texture;
+}
+
+SDL_Texture* TextureCache::Insert(const std::string& name, SDL_Texture* texture, const std::string& scene_name) {
+    // No scene means the current one
+    int scene_id = scene_name.empty() ? scene : SceneId(scene_name);
+    auto existing = entries.find(name);
+    if(existing != entries.end()) {
+        if(texture != existing->second.texture) {
+            SDL_DestroyTexture(texture);
+        }
+        AddReference(existing->second, scene_id);
+        return existing->second.texture;
+    }
+    // Trim first so the texture being added is never the one evicted
+    Trim();
+    Entry entry;
+    entry.texture = texture;
+    Uint32 format = 0;
+    int width = 0, height = 0;
+    SDL_QueryTexture(texture, &format, NULL, &width, &height);
+    int bytes_per_pixel = SDL_BYTESPERPIXEL(format);
+    entry.bytes = static_cast<size_t>(width) * height * (bytes_per_pixel > 0 ? bytes_per_pixel : 4);
+    entry.last_used = ++clock;
+    entry.orphaned = switches;
+    AddReference(entry, scene_id);
+    resident += entry.bytes;
+    entries.emplace(name, std::move(entry));
+    return texture;
+}
+
+bool TextureCache::Reference(const std::string& name, const std::string& scene_name) {
+    auto entry = entries.find(name);
+    if(entry == entries.end()) {
+        return false;
+    }
+    AddReference(entry->second, SceneId(scene_name));
+    return true;
+}
+
+std::vector<std::string> TextureCache::GetNames() {
+    std::vector<std::string> names;
+    names.reserve(entries.size());
+    for(auto& [name, entry] : entries) {
+        names.push_back(name);
+    }
+    return names;
+}
+
+void TextureCache::Pin(const std::string& name) {
+    auto entry = entries.find(name);
+    if(entry != entries.end()) {
+        ++entry->second.pins;
+    }
+}
+
+void TextureCache::Unpin(const std::string& name) {
+    auto entry = entries.find(name);
+    if(entry != entries.end() && --entry->second.pins == 0) {
+        entry->second.orphaned = switches;
+    }
+}
+
+// A full scene switch; the old scene's references go but nothing is evicted
+// until Trim, so textures the next scene also uses can be picked back up
+void TextureCache::SetScene(const std::string& scene_name) {
+    int id = SceneId(scene_name);
+    if(id == scene) {
+        return;
+    }
+    ++switches;
+    int previous = scene;
+    scene = id;
+    if(previous < 0) {
+        return;
+    }
+    for(auto& [name, entry] : entries) {
+        auto ref = std::find(entry.scenes.begin(), entry.scenes.end(), previous);
+        if(ref == entry.scenes.end()) {
+            continue;
+        }
+        entry.scenes.erase(ref);
+        if(entry.scenes.empty()) {
+            entry.orphaned = switches;
+        }
+    }
+}
+
+// For scenes other than the current one (streamed chunks, cancelled loads)
+void TextureCache::ReleaseScene(const std::string& scene_name) {
+    auto id = scene_ids.find(scene_name);
+    if(id == scene_ids.end() || id->second == scene) {
+        return;
+    }
+    for(auto& [name, entry] : entries) {
+        auto ref = std::find(entry.scenes.begin(), entry.scenes.end(), id->second);
+        if(ref == entry.scenes.end()) {
+            continue;
+        }
+        entry.scenes.erase(ref);
+        if(entry.scenes.empty()) {
+            entry.orphaned = switches;
+        }
+    }
+    Trim();
+}
+
+// Only unreferenced textures are evicted, and anything drawn this frame is
+// referenced, so this is safe while draw requests are queued
+void TextureCache::Trim() {
+    // Left unreferenced through a whole scene
+    for(auto entry = entries.begin(); entry != entries.end();) {
+        auto next = std::next(entry);
+        if(entry->second.pins == 0 && entry->second.scenes.empty() && entry->second.orphaned < switches) {
+            Evict(entry);
+        }
+        entry = next;
+    }
+    if(resident <= budget) {
+        return;
+    }
+    std::vector<std::unordered_map<std::string, Entry>::iterator> candidates;
+    for(auto entry = entries.begin(); entry != entries.end(); ++entry) {
+        if(entry->second.pins == 0 && entry->second.scenes.empty()) {
+            candidates.push_back(entry);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](auto a, auto b) {
+        return a->second.last_used < b->second.last_used;
+    });
+    for(auto entry : candidates) {
+        if(resident <= budget) {
+            break;
+        }
+        Evict(entry);
+    }
+}
+
+void TextureCache::Report() {
+    if(EngineUtils::GetEnvVariable("TEXTURE_CACHE_REPORT").empty()) {
+        return;
+    }
+    Logger::Flush();
+    std::cout << "texture cache: " << entries.size() << " textures " << (resident >> 10) << " KB resident, hit rate " << GetHitRate() << ", " << evictions << " evicted" << std::endl;
+}
+
+float TextureCache::GetHitRate() {
+    int requests = hits + misses;
+    return requests == 0 ? 0.0f : static_cast<float>(hits) / requests;
+}
+
+long long TextureCache::GetResidentBytes() {
+    return static_cast<long long>(resident);
+}
+
+int TextureCache::GetEvictions() {
+    return evictions;
+}
+
+int TextureCache::SceneId(const std::string& scene_name) {
+    if(scene_name.empty()) {
+        return -1;
+    }
+    return scene_ids.emplace(scene_name, static_cast<int>(scene_ids.size())).first->second;
+}
+
+void TextureCache::AddReference(Entry& entry, int scene_id) {
+    if(scene_id >= 0 && std::find(entry.scenes.begin(), entry.scenes.end(), scene_id) == entry.scenes.end()) {
+        entry.scenes.push_back(scene_id);
+    }
+}
+
+void TextureCache::Evict(std::unordered_map<std::string, Entry>::iterator entry) {
+    SDL_DestroyTexture(entry->second.texture);
+    resident -= entry->second.bytes;
+    ++evictions;
+    entries.erase(entry);
+}
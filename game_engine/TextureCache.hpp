@@ -0,0 +1,72 @@
+//
+//  TextureCache.hpp
+//  game_engine
+//
+//  Created by Jasmine Li on 5/4/24.
+//
+
+#ifndef TextureCache_hpp
+#define TextureCache_hpp
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <SDL2/SDL.h>
+
+// Owner of every image texture. Each texture is referenced by the scenes (and
+// streamed chunks) that use it; a texture drawn while no scene holds it is
+// taken by the current scene. Textures no loaded scene references stay cached
+// until texture_budget_mb is exceeded and are then evicted least recently used
+// first; ones left unreferenced through a whole scene are unloaded on the next
+// scene switch. Pinned textures (held by animation models) are never evicted.
+// Set TEXTURE_CACHE_REPORT to print hit rate, resident size and evictions at exit.
+class TextureCache {
+public:
+    static void Initialize();
+    static SDL_Texture* Find(const std::string& name);
+    static SDL_Texture* Insert(const std::string& name, SDL_Texture* texture, const std::string& scene = "");
+    static bool Reference(const std::string& name, const std::string& scene);
+    static std::vector<std::string> GetNames();
+
+    static void Pin(const std::string& name);
+    static void Unpin(const std::string& name);
+
+    static void SetScene(const std::string& scene);
+    static void ReleaseScene(const std::string& scene);
+    static void Trim();
+    static void Report();
+
+    static float GetHitRate();
+    static long long GetResidentBytes();
+    static int GetEvictions();
+
+private:
+    struct Entry {
+        SDL_Texture* texture = nullptr;
+        size_t bytes = 0;
+        uint64_t last_used = 0;
+        int pins = 0;
+        int orphaned = 0; // scene switch at which the last reference went
+        std::vector<int> scenes;
+    };
+
+    static inline std::unordered_map<std::string, Entry> entries;
+    static inline std::unordered_map<std::string, int> scene_ids;
+    static inline int scene = -1;
+    static inline int switches = 0;
+    static inline uint64_t clock = 0;
+
+    static inline size_t budget = 256u << 20;
+    static inline size_t resident = 0;
+    static inline int hits = 0;
+    static inline int misses = 0;
+    static inline int evictions = 0;
+
+    static int SceneId(const std::string& scene_name);
+    static void AddReference(Entry& entry, int scene_id);
+    static void Evict(std::unordered_map<std::string, Entry>::iterator entry);
+};
+
+#endif /* TextureCache_hpp */
@@ -23,6 +23,15 @@
 #include "lua.hpp"
 #include "LuaBridge.h"
 #include "Animation.hpp"
+#include "Region.hpp"
+#include "LuaGC.hpp"
+#include "Profiler.hpp"
+#include "Coroutines.hpp"
+#include "Logger.hpp"
+#include "SceneBinary.hpp"
+#include "AsyncScene.hpp"
+#include "SceneStream.hpp"
+#include "Startup.hpp"
  
 bool playing = true;
 bool waiting = false;
@@ -43,17 +52,23 @@ std::unordered_set<Actor*> nearby_sfx_triggered;
 std::string next_scene = "";
 
 int main(int argc, char * argv[]) {
-    ComponentDB::Initialize();
-    LoadInitialScene();
+    bool startup_trace = false;
+    for(int i = 1; i < argc; ++i) {
+        // Offline: compile every scene to .cache/scenes and exit
+        if(std::string(argv[i]) == "--compile-scenes") {
+            ComponentDB::Initialize();
+            LoadInitialScene();
+            SceneBinary::Initialize();
+            std::cout << "compiled " << SceneBinary::CompileAll() << " scenes" << std::endl;
+            return 0;
+        }
+        if(std::string(argv[i]) == "--startup-trace") {
+            startup_trace = true;
+        }
+    }
 
     std::string cmd;
-    if (game_start_message != "") {
-        std::cout << game_start_message << std::endl;
-    }
-    
-    Audio::Initialize();
-    Image::Initialize();
-    Text::Initialize();
+    Startup::Run(startup_trace);
     
     Input::Init();
     while(playing) {
@@ -72,20 +87,26 @@ int main(int argc, char * argv[]) {
         for(auto &a : actors) {
             a->OnStart();
         }
+        Actor::BeginUpdate();
         for(auto &a : actors) {
             a->Update();
         }
+        Coroutines::Update();
         Input::LateUpdate();
         for(auto &a : actors) {
             a->LateUpdate();
         }
         Actor::FrameEnd();
+        Logger::FrameEnd();
         
+        EventManager::ProcessQueue();
         EventManager::ProcessSubscriptions();
         EventManager::ProcessUnsubscriptions();
         
         // Physics step
         Physics::Step();
+        Coroutines::AfterPhysics();
+        Region::Update();
         
         // Render
         Image::Clear();
@@ -113,11 +134,15 @@ int main(int argc, char * argv[]) {
             SDL_RenderDrawPoint(Scene::renderer, p.x, p.y);
             pixel_render_queue.pop();
         }
+        // Lua GC in the slack before the frame delay
+        LuaGC::Step();
         Helper::SDL_RenderPresent498(Scene::renderer);
         
         if(Scene::load_new) {
             Scene::LoadScene(Scene::current_scene);
         }
+        AsyncScene::Update();
+        SceneStream::Update();
     }
     if(quit) {
         return 0;